@@ -12,6 +12,7 @@
 
 #include "GameBoy.h"
 #include "Renderer.h"
+#include "Disassembler.h"
 
 #include <iostream>
 #include <algorithm>
@@ -27,9 +28,6 @@ public:
 
 	void Run();
 private:
-	void AddBreakpoint(uint16_t address);
-	void RemoveBreakpoint(uint16_t index);
-
 	void ConfigureImGui();
 
 	void RenderGUI();
@@ -38,6 +36,8 @@ private:
 
 	Renderer* renderer;
 
+	Disassembler* disassembler;
+
 	float dt = 0.0;
 
 	// Gameboy variables
@@ -48,16 +48,31 @@ private:
 	bool show_vram_view = false;
 	bool show_breakpoints = false;
 	bool show_disassembly = false;
+	bool show_code_data_logger = false;
+	bool show_profiler = false;
 	bool show_menu_bar = true;
 	uint32_t current_breakpoint_item = 0;
-	std::string hex_val = "0000";
+	char breakpoint_address[8] = "0000";
+	char breakpoint_condition[128] = "";
+	std::string breakpoint_error;
+	int breakpoint_bank = BREAKPOINT_ANY_BANK;
+	uint32_t current_watchpoint_item = 0;
+	char watch_address[8] = "0000";
+	bool watch_read = false;
+	bool watch_write = true;
 	bool paused = false;
 
 	float vram_debug_image_scale = 1.0;
 	VRAMDebugInfo vram_render_info;
 
-	// Breakpoints
-	std::vector<uint16_t> breakpoints;
+	float cdl_refresh_timer = 0.0f;
+	CDLCoverage cdl_coverage = { 0 };
+
+	float profiler_refresh_timer = 0.0f;
+	bool profiler_by_function = false;
+	int profiler_rows = 20;
+	uint64_t profiler_total_cycles = 0;
+	std::vector<ProfileEntry> profiler_entries;
 };
 
 #endif
\ No newline at end of file
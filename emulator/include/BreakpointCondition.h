@@ -0,0 +1,94 @@
+#ifndef EMULATOR_BREAKPOINT_CONDITION_H_
+#define EMULATOR_BREAKPOINT_CONDITION_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class GameBoy;
+
+#define CONDITION_MAX_STACK 32
+
+// Conditions are written like "A == 0x3C && [0xC0A0] > 5" or "hits >= 1000".
+// Operands: numbers (0x3C, $3C or decimal), registers (A F B C D E H L AF BC DE HL SP PC),
+// flags (ZF NF HF CF), memory bytes ([expr]) and the breakpoint hit count (hits).
+// Operators from lowest to highest precedence:
+// || && | ^ & (== != < <= > >=) (+ -) and the unary ! - ~
+enum ConditionOp : uint8_t
+{
+	COND_PUSH,
+	COND_REGISTER,
+	COND_HITS,
+	COND_READ,
+	COND_NOT,
+	COND_NEGATE,
+	COND_COMPLEMENT,
+	COND_ADD,
+	COND_SUB,
+	COND_EQUAL,
+	COND_NOT_EQUAL,
+	COND_LESS,
+	COND_LESS_EQUAL,
+	COND_GREATER,
+	COND_GREATER_EQUAL,
+	COND_BIT_AND,
+	COND_BIT_XOR,
+	COND_BIT_OR,
+	COND_LOGICAL_AND,
+	COND_LOGICAL_OR
+};
+
+enum ConditionRegister : uint8_t
+{
+	COND_REG_A, COND_REG_F, COND_REG_B, COND_REG_C,
+	COND_REG_D, COND_REG_E, COND_REG_H, COND_REG_L,
+	COND_REG_AF, COND_REG_BC, COND_REG_DE, COND_REG_HL,
+	COND_REG_SP, COND_REG_PC,
+	COND_FLAG_Z, COND_FLAG_N, COND_FLAG_H, COND_FLAG_C
+};
+
+struct ConditionInstruction
+{
+	ConditionOp op;
+	int32_t value; // constant for COND_PUSH, ConditionRegister for COND_REGISTER
+};
+
+class BreakpointCondition
+{
+public:
+	// Parses the expression once into stack bytecode, an empty source always passes.
+	// On failure error holds the reason and the condition is left empty.
+	bool Compile(const std::string& source);
+
+	bool Evaluate(GameBoy* gb, uint32_t hits);
+
+	bool IsEmpty() { return this->program.empty(); }
+
+	std::string source;
+	std::string error;
+private:
+	struct Token
+	{
+		enum Type { NUMBER, IDENTIFIER, OPERATOR, END } type;
+		std::string text;
+		int32_t value;
+	};
+
+	bool Tokenize(const std::string& text);
+
+	bool ParseBinary(int level);
+	bool ParseUnary();
+	bool ParsePrimary();
+
+	void Emit(ConditionOp op, int32_t value = 0);
+
+	std::vector<ConditionInstruction> program;
+
+	// parser state, only used while compiling
+	std::vector<Token> tokens;
+	size_t position = 0;
+	int32_t stack_depth = 0;
+	int32_t max_stack_depth = 0;
+};
+
+#endif
\ No newline at end of file
@@ -64,7 +64,7 @@ static std::string opcode_names[256] = {
     "DEC SP",
     "INC A",
     "DEC A",
-    "LDA,n",
+    "LD A,n",
     "CCF",
     "LD B,B",
     "LD B,C",
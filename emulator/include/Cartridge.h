@@ -9,6 +9,8 @@
 
 #include <portable-file-dialogs.h>
 
+#include "RealTimeClock.h"
+
 enum CartridgeType
 {
 	ROM_ONLY,
@@ -60,6 +62,9 @@ struct CartridgeHeader
 	CartridgeType cartridge_type;
 	ROMSize rom_size;
 	RAMSize ram_size;
+
+	bool has_battery; // ram (and the clock) are kept in a .sav file
+	bool has_rtc;
 };
 
 class Mapper
@@ -80,10 +85,24 @@ public:
 	size_t allocated_ram_size;
 	size_t allocated_rom_size;
 
-	uint8_t rom_bank_count;
+	uint16_t rom_bank_count; // up to 512 on MBC5
 	uint8_t ram_bank_count;
-private:
 
+	// Bank currently mapped at 0x4000-0x7FFF
+	uint16_t rom_bank_number = 1;
+	uint8_t ram_bank_number = 0;
+
+	// MBC3 clock, nullptr on cartridges without one
+	RealTimeClock* rtc = nullptr;
+
+	// Memory mapped at 0x0000-0x3FFF, 0x4000-0x7FFF and 0xA000-0xBFFF, the bus reads these in place.
+	// ram_bank is nullptr while cartridge ram has to go through ReadRAM and WriteRAM.
+	const uint8_t* rom0_bank = nullptr;
+	const uint8_t* romx_bank = nullptr;
+	uint8_t* ram_bank = nullptr;
+protected:
+	// Publishes the banks above, called whenever a banking register changes
+	virtual void UpdateBanks();
 };
 
 class NoMBC : public Mapper
@@ -112,13 +131,48 @@ public:
 
 	uint8_t ReadRAM(uint16_t address) override;
 	void WriteRAM(uint16_t address, uint8_t value) override;
+protected:
+	void UpdateBanks() override;
 private:
-	uint8_t rom_bank_number = 1;
-	uint8_t ram_bank_number = 0;
 	uint8_t banking_mode = 0;
 	bool ram_enabled = false;
 };
 
+class MBC3 : public Mapper
+{
+public:
+	MBC3(CartridgeHeader& header);
+	~MBC3();
+
+	uint8_t ReadROM(uint16_t address) override;
+	void WriteROM(uint16_t address, uint8_t value) override;
+
+	uint8_t ReadRAM(uint16_t address) override;
+	void WriteRAM(uint16_t address, uint8_t value) override;
+protected:
+	void UpdateBanks() override;
+private:
+	bool ram_enabled = false;
+	uint8_t latch_value = 0xFF; // last write to 0x6000-0x7FFF, 0 then 1 latches the clock
+};
+
+class MBC5 : public Mapper
+{
+public:
+	MBC5(CartridgeHeader& header);
+	~MBC5();
+
+	uint8_t ReadROM(uint16_t address) override;
+	void WriteROM(uint16_t address, uint8_t value) override;
+
+	uint8_t ReadRAM(uint16_t address) override;
+	void WriteRAM(uint16_t address, uint8_t value) override;
+protected:
+	void UpdateBanks() override;
+private:
+	bool ram_enabled = false;
+};
+
 class Cartridge
 {
 public:
@@ -134,6 +188,23 @@ public:
 	uint8_t ReadRAM(uint16_t address);
 	void WriteRAM(uint16_t address, uint8_t value);
 
+	uint16_t GetROMBank();
+	uint16_t GetROMBankCount();
+
+	RealTimeClock* GetRTC() { return (this->active_mapper != nullptr) ? this->active_mapper->rtc : nullptr; }
+
+	// Battery backed ram and clock, next to the rom as name.sav
+	bool LoadSave();
+	bool WriteSave();
+
+	// Banks the bus reads in place, they change after WriteROM
+	const uint8_t* GetROM0Bank() { return (this->active_mapper != nullptr) ? this->active_mapper->rom0_bank : nullptr; }
+	const uint8_t* GetROMXBank() { return (this->active_mapper != nullptr) ? this->active_mapper->romx_bank : nullptr; }
+	uint8_t* GetRAMBank() { return (this->active_mapper != nullptr) ? this->active_mapper->ram_bank : nullptr; }
+
+	// 0x4000 bytes of a rom bank, bank 0 includes the bootrom while it is mapped
+	const uint8_t* GetROMBankData(uint16_t bank);
+
 	std::string path;
 	CartridgeHeader header = {0};
 private:
@@ -141,6 +212,7 @@ private:
 	uint8_t stored_rom_binarys[256];
 
 	bool LoadCartridgeHeader(uint8_t* rom);
+	std::string GetSavePath();
 };
 
 #endif
\ No newline at end of file
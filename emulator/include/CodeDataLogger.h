@@ -0,0 +1,67 @@
+#ifndef EMULATOR_CODE_DATA_LOGGER_H_
+#define EMULATOR_CODE_DATA_LOGGER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class GameBoy;
+
+enum CDLFlags : uint8_t
+{
+	CDL_CODE = 0x01, // executed as an opcode
+	CDL_OPERAND = 0x02, // read as an instruction operand
+	CDL_DATA = 0x04 // read as data
+};
+
+struct CDLCoverage
+{
+	uint32_t rom_size;
+	uint32_t code_bytes;
+	uint32_t operand_bytes;
+	uint32_t data_bytes;
+	uint32_t touched_bytes;
+};
+
+// Records how every ROM byte was accessed, indexed by ROM offset so the bank is
+// part of the index (offset / 0x4000). Costs nothing while disabled.
+class CodeDataLogger
+{
+public:
+	CodeDataLogger(GameBoy* gameboy);
+	~CodeDataLogger();
+
+	// Resizes the map for the loaded ROM and clears it
+	void Reset();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() { return this->enabled; }
+
+	// Called by the cpu before it fetches the instruction at address
+	void LogInstruction(uint16_t address);
+
+	// Called by the memory bus for ROM reads while enabled
+	void LogRead(uint16_t address);
+
+	uint8_t GetFlags(uint32_t rom_offset);
+	uint32_t GetROMOffset(uint16_t address);
+
+	CDLCoverage GetCoverage();
+
+	// File layout: "GBCDL" magic, version byte, rom size (u32 little endian)
+	// followed by the flags packed two entries per byte (low nibble first)
+	bool Export(const std::string& path);
+	bool Import(const std::string& path); // merges with the current flags
+private:
+	GameBoy* gb;
+
+	bool enabled = false;
+
+	std::vector<uint8_t> flags;
+
+	// bytes of the instruction being executed, reads to them are operands not data
+	uint16_t instruction_address = 0;
+	uint8_t instruction_length = 0;
+};
+
+#endif
\ No newline at end of file
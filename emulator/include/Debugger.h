@@ -0,0 +1,91 @@
+#ifndef EMULATOR_DEBUGGER_H_
+#define EMULATOR_DEBUGGER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "BreakpointCondition.h"
+
+class GameBoy;
+
+#define BREAKPOINT_ANY_BANK -1
+
+enum WatchpointType
+{
+	WATCH_READ = 0x01,
+	WATCH_WRITE = 0x02,
+	WATCH_READ_WRITE = 0x03
+};
+
+struct Breakpoint
+{
+	uint16_t address;
+	int32_t bank; // only used for 0x4000-0x7FFF, BREAKPOINT_ANY_BANK matches every bank
+	BreakpointCondition condition; // only evaluated when the address matches
+	uint32_t hit_count;
+};
+
+struct Watchpoint
+{
+	uint16_t address;
+	uint8_t type;
+};
+
+class Debugger
+{
+public:
+	Debugger(GameBoy* gameboy);
+	~Debugger();
+
+	// Rebuilds the lookup maps, must be called when a new ROM is loaded
+	void Reset();
+
+	void AddBreakpoint(uint16_t address, int32_t bank = BREAKPOINT_ANY_BANK, const BreakpointCondition& condition = BreakpointCondition());
+	void RemoveBreakpoint(uint32_t index);
+
+	void AddWatchpoint(uint16_t address, uint8_t type);
+	void RemoveWatchpoint(uint32_t index);
+
+	// True when at least one breakpoint or watchpoint is set, the run loop
+	// only pays for the checks when this is set
+	bool IsArmed() { return this->armed; }
+
+	void BeginRun();
+	void EndRun();
+
+	// Called by the checking run loop before an instruction is fetched
+	bool CheckExecution(uint16_t pc);
+
+	// Called by the memory bus, only while watchpoints are armed
+	void OnRead(uint16_t address);
+	void OnWrite(uint16_t address);
+
+	std::vector<Breakpoint> breakpoints;
+	std::vector<Watchpoint> watchpoints;
+
+	bool break_requested = false;
+
+	uint16_t last_hit_address = 0;
+	bool last_hit_was_watchpoint = false;
+private:
+	void RebuildMaps();
+
+	bool TestExecutionBit(uint16_t pc);
+	bool EvaluateBreakpoints(uint16_t pc);
+	void CheckWatchpoints(uint16_t address, uint8_t type);
+
+	GameBoy* gb;
+
+	bool armed = false;
+	bool running = false; // accesses from the GUI are not checked
+
+	// pc the last run stopped at, so resuming does not hit the same breakpoint again
+	int32_t resume_pc = -1;
+
+	uint64_t exec_bitmap[0x10000 / 64]; // breakpoints that match any bank
+	std::vector<uint64_t> banked_exec_bitmap; // 0x4000 bits per ROM bank for 0x4000-0x7FFF
+
+	uint8_t watch_pages[0x100]; // WatchpointType bits for each 256 byte page
+};
+
+#endif
\ No newline at end of file
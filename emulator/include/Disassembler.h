@@ -0,0 +1,75 @@
+#ifndef EMULATOR_DISASSEMBLER_H_
+#define EMULATOR_DISASSEMBLER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+class GameBoy;
+
+struct DisassemblyRow
+{
+	uint16_t address;
+	uint8_t length;
+	uint8_t bytes[3];
+	bool data; // logged as data by the code/data logger, shown as a single byte
+};
+
+enum DisassemblyRegion
+{
+	REGION_ROM0, // 0x0000-0x3FFF
+	REGION_ROMX, // 0x4000-0x7FFF, cached per bank
+	REGION_VRAM, // 0x8000-0x9FFF
+	REGION_EXTERNAL_RAM, // 0xA000-0xBFFF
+	REGION_WRAM, // 0xC000-0xDFFF
+	REGION_HIGH, // 0xE000-0xFFFF
+	REGION_COUNT
+};
+
+// Linear sweep disassembly of the address space, decoded once per region and kept
+// until the bytes behind a visible row change or another ROM bank is mapped.
+class Disassembler
+{
+public:
+	Disassembler(GameBoy* gameboy);
+	~Disassembler();
+
+	void Invalidate();
+
+	// Picks the cache for the mapped ROM bank and rebuilds stale regions
+	void Update();
+
+	// Compares the rows in [first, last) with memory and marks their region for rebuild
+	void Validate(size_t first, size_t last);
+
+	size_t GetRowCount();
+	const DisassemblyRow& GetRow(size_t index);
+	size_t FindRow(uint16_t address);
+
+	// Writes "BB:AAAA" for banked ROM and "AAAA" for everything else
+	void FormatAddress(const DisassemblyRow& row, char* buffer, size_t size);
+	void FormatInstruction(const DisassemblyRow& row, char* buffer, size_t size);
+private:
+	struct RegionCache
+	{
+		std::vector<DisassemblyRow> rows;
+		bool dirty = true;
+	};
+
+	void DecodeRegion(DisassemblyRegion region, RegionCache& cache);
+	RegionCache& GetRegion(DisassemblyRegion region);
+	bool IsLoggedData(uint16_t address);
+
+	GameBoy* gb;
+
+	RegionCache regions[REGION_COUNT];
+	std::unordered_map<uint16_t, RegionCache> banked_regions;
+
+	uint16_t current_bank = 0;
+	bool bootrom_mapped = false;
+
+	size_t region_start_rows[REGION_COUNT + 1];
+};
+
+#endif
\ No newline at end of file
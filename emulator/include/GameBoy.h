@@ -5,12 +5,16 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <functional>
 
 #include "MemoryBus.h"
 #include "CPU/CPU.h"
 #include "Cartridge.h"
 #include "Timer.h"
 #include "PPU.h"
+#include "Debugger.h"
+#include "CodeDataLogger.h"
+#include "Profiler.h"
 
 enum Joypad
 {
@@ -24,6 +28,9 @@ enum Joypad
 	BUTTON_START = 7
 };
 
+// Receives each completed frame (160x144 shades) and its number
+typedef std::function<void(const uint8_t* pixels, uint64_t frame)> FrameCallback;
+
 class GameBoy
 {
 public:
@@ -32,11 +39,17 @@ public:
 
 	void Update(float dt);
 
+	// Runs the given amount of M-Cycles, returns true if a breakpoint or watchpoint stopped it
+	bool Run(uint32_t cycles);
+
 	CPU* cpu = nullptr;
 	PPU* ppu = nullptr;
 	MemoryBus* mmu = nullptr;
 	Cartridge* active_cartridge = nullptr;
 	Timer* timer = nullptr;
+	Debugger* debugger = nullptr;
+	CodeDataLogger* cdl = nullptr;
+	Profiler* profiler = nullptr;
 	
 	void OnInputPressed(Joypad button);
 	void OnInputReleased(Joypad button);
@@ -44,9 +57,35 @@ public:
 	uint8_t UpdateInput(uint8_t joyp);
 
 	bool LoadROM(std::string rom_path);
+
+	bool IsBootromMapped() { return this->on_bootrom; }
+
+	// M-cycles emulated since the emulator started
+	uint64_t GetCycleCount() { return this->cycle_count; }
+
+	// Clock the MBC3 real time clock follows, kept for the next cartridges
+	void SetRTCClock(RTCClock clock);
+	RTCClock GetRTCClock() { return this->rtc_clock; }
+
+	// Called on the emulation thread when V-Blank starts, pixels stay valid until the next frame completes
+	void SetFrameCallback(FrameCallback callback) { this->frame_callback = callback; }
+
+	// Last completed frame and the number of frames completed so far
+	const uint8_t* GetFrame() { return this->ppu->GetFrontBuffer(); }
+	uint64_t GetFrameCount() { return this->ppu->GetFrameCount(); }
+
+	// Called by the ppu after it swapped its framebuffers
+	void OnFrameComplete();
 private:
+	bool RunChecked(uint32_t cycles);
+
+	FrameCallback frame_callback;
+
 	bool keys[8];
 	bool on_bootrom = false;
+
+	uint64_t cycle_count = 0;
+	RTCClock rtc_clock = RTC_CLOCK_EMULATED;
 };
 
 #endif
\ No newline at end of file
@@ -7,6 +7,33 @@
 
 class GameBoy;
 
+#define MEMORY_PAGE_SHIFT 8
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT (0x10000 >> MEMORY_PAGE_SHIFT)
+
+// Contiguous regions that can be viewed in place
+enum MemoryRegion
+{
+	MEMORY_REGION_ROM0, // 0x0000-0x3FFF, the bootrom overlays its first 256 bytes while mapped
+	MEMORY_REGION_ROMX, // 0x4000-0x7FFF, the bank currently mapped there
+	MEMORY_REGION_VRAM, // 0x8000-0x9FFF
+	MEMORY_REGION_WRAM, // 0xC000-0xDFFF
+	MEMORY_REGION_OAM // 0xFE00-0xFE9F
+};
+
+struct MemorySpan
+{
+	const uint8_t* data; // nullptr when nothing is mapped there
+	uint32_t size;
+	uint16_t address; // of data[0]
+};
+
+enum MemoryHook : uint8_t
+{
+	HOOK_WATCHPOINTS = 0x01,
+	HOOK_CODE_DATA_LOGGER = 0x02
+};
+
 class MemoryBus
 {
 public:
@@ -17,8 +44,74 @@ public:
 
 	void Write(uint32_t address, uint8_t data);
 	uint8_t Read(uint32_t address);
+
+	// Reads without triggering debugger hooks, for tools and the debugger itself
+	uint8_t Peek(uint32_t address);
+
+	// Peeks length bytes from address on, mapped pages are copied whole
+	void ReadBlock(uint32_t address, uint8_t* dst, uint32_t length);
+
+	// View of a whole region, valid until the region is remapped (bank switch, new cartridge)
+	MemorySpan GetSpan(MemoryRegion region);
+
+	// Hooks are only called while enabled, Read and Write check a single mask
+	void SetHook(uint8_t hook, bool enabled);
+
+	// Called by the ppu when its mode changes. Locked pages read 0xFF and drop writes
+	// until they are unlocked, Peek still sees the memory behind them.
+	void SetVideoMemoryLocks(bool vram_locked, bool oam_locked);
+
+	// Advances an OAM DMA transfer by one M-cycle
+	void Tick()
+	{
+		if (this->dma_cycles != 0 && --this->dma_cycles == 0)
+		{
+			this->UpdatePages();
+		}
+	}
+
+	bool IsDMAActive() { return this->dma_cycles != 0; }
 private:
+	void RunReadHooks(uint32_t address);
+
+	// Points the pages of plain memory at their storage, everything else takes the slow path
+	void MapPages();
+
+	// Builds the read and write pages from the mapped ones, the locks and the dma restriction
+	void UpdatePages();
+	void UpdateVideoMemoryPages();
+
+	// Maps the banks the cartridge publishes, after a write to its registers
+	void MapCartridgePages();
+	void UpdateCartridgePages();
+
+	void StartDMA(uint8_t source_page);
+
 	GameBoy* gb;
+
+	uint8_t hooks = 0;
+
+	// memory that can be read in place, as if nothing was locked
+	const uint8_t* mapped_pages[MEMORY_PAGE_COUNT] = { 0 };
+
+	// Read and Write go straight to these pages, nullptr pages go through the address checks
+	const uint8_t* read_pages[MEMORY_PAGE_COUNT] = { 0 };
+	uint8_t* write_pages[MEMORY_PAGE_COUNT] = { 0 };
+
+	// cartridge banks the pages were mapped from
+	const uint8_t* rom0_bank = nullptr;
+	const uint8_t* romx_bank = nullptr;
+	uint8_t* ram_bank = nullptr;
+
+	bool vram_locked = false;
+	bool oam_locked = false;
+
+	// M-cycles left in the current OAM DMA transfer
+	uint8_t dma_cycles = 0;
+
+	// swapped in for locked pages
+	uint8_t locked_page[MEMORY_PAGE_SIZE];
+	uint8_t discard_page[MEMORY_PAGE_SIZE];
 };
 
 #endif
\ No newline at end of file
@@ -7,10 +7,15 @@
 #include <stdint.h>
 #include <iostream>
 #include <bitset>
+#include <atomic>
 
 #include "BitwiseUtils.h"
+#include "PixelKernels.h"
+#include "VideoMemory.h"
+#include "ScanlineRenderer.h"
 
 class GameBoy;
+class RenderThread;
 
 enum FetcherType
 {
@@ -19,18 +24,20 @@ enum FetcherType
     SPRITE
 };
 
-struct FIFOPixel
+// FIFO entries are one byte: the background color id, the color id of an object
+// mixed over it, that object's palette and its priority over the background.
+// Palettes and priority are applied when the pixel is shifted out.
+#define FIFO_SIZE 16 // power of two, indices wrap with a mask
+#define FIFO_BG_COLOR(pixel) ((pixel) & 0x03)
+#define FIFO_OBJ_COLOR(pixel) (((pixel) >> 2) & 0x03)
+#define FIFO_OBJ_COLOR_SHIFT 2
+#define FIFO_OBJ_PALETTE 0x10 // OBP1 instead of OBP0
+#define FIFO_OBJ_BEHIND_BG 0x20 // hidden behind background colors 1-3
+
+enum PPURenderMode
 {
-    uint8_t color; // 0 to 3
-    FetcherType type;
-};
-
-struct Sprite
-{
-    uint8_t y_pos;
-    uint8_t x_pos;
-    uint8_t tile;
-    uint8_t flags;
+    PPU_RENDER_FIFO, // pixel FIFO with fetcher stages, sees register writes in the middle of mode 3
+    PPU_RENDER_SCANLINE // whole scanline at the end of mode 3, much cheaper
 };
 
 struct Fetcher
@@ -56,25 +63,112 @@ public:
     uint8_t ReadVRAM(uint32_t address);
     void WriteVRAM(uint32_t address, uint8_t data);
 
-    bool IsVRAMAcessible();
+    // 0x8000-0x9FFF, the memory bus reads it in place
+    const uint8_t* GetVRAMData() { return this->video_memory.GetData(); }
+
+    // 0xFE00-0xFE9F
+    const uint8_t* GetOAMData() { return this->oam; }
+
+    // Color ids (0-3) of the 8 pixels of a tile row, offset is the row's position in vram
+    // (tile * 0x10 + row * 2). Flipped returns the row mirrored horizontally.
+    const uint8_t* GetTileRow(uint16_t offset, bool flipped) { return this->video_memory.GetTileRow(offset, flipped); }
+
+    // Decodes every dirty tile row
+    void FlushTileCache() { this->video_memory.FlushTileCache(); }
+
+    // LCD registers at 0xFF40-0xFF4B, except the DMA register at 0xFF46
+    uint8_t ReadRegister(uint16_t address);
+    void WriteRegister(uint16_t address, uint8_t data);
 
     uint8_t ReadOAM(uint32_t address);
     void WriteOAM(uint32_t address, uint8_t data);
 
+    // All 0xA0 bytes of oam at once, for OAM DMA
+    void WriteOAMBlock(const uint8_t* data);
+
     void SwitchMode(uint8_t mode);
 
-    uint32_t screen_pixels[160 * 144] = { 0 };
+    // Frame being drawn, shades 0-3 (see ConvertShades for other formats).
+    // Swapped with the front buffer when V-Blank starts.
+    uint8_t* screen_pixels = nullptr;
+
+    // Last completed frame, left untouched until the next V-Blank
+    const uint8_t* GetFrontBuffer() { return this->framebuffers[(this->GetFrameCount() + 1) & 1]; }
+
+    // Completed frames since power on, safe to read from other threads
+    uint64_t GetFrameCount() { return this->frame_count.load(std::memory_order_acquire); }
 
     bool requested_vram_debug_update = false;
+
+    // takes effect on the next scanline
+    PPURenderMode render_mode = PPU_RENDER_FIFO;
+
+    // Frames skipped after each drawn one, takes effect on the next frame. Skipped frames keep
+    // the mode timing of the scanline renderer but draw nothing and are not counted or swapped in.
+    uint32_t frame_skip = 0;
+
+    // Draws the lines of the scanline renderer on a worker thread, the emulation
+    // only waits for it when a frame is swapped in
+    void SetRenderThread(bool enabled);
+    bool IsRenderThreadEnabled() { return this->render_thread != nullptr; }
 private:
     uint16_t GetTile(uint8_t id, bool obj); // returns tile address
 
     void PushToLCD(uint8_t cycles);
 
+    void BuildLineObjects(uint8_t sprite_height);
+
+    void BuildPaletteTables();
+
+    uint16_t GetScanlineDrawingTime(uint8_t ly);
+    void RenderScanline();
+    void LogRegisterWrite(uint16_t address, uint8_t data);
+
+    // The field of a segment a register write changes, nullptr for registers the renderer does not read
+    static uint8_t* GetSegmentRegister(ScanlineRegisters& registers, uint16_t address);
+
+    void SwapFramebuffers();
+
+    void TurnOffLCD();
+    void TurnOnLCD();
+
+    // Updates the coincidence flag and the STAT interrupt line, called whenever LY, LYC, STAT or the mode change
+    void UpdateSTATLine();
+
     GameBoy* gb;
+    const PixelKernels* kernels;
 
     uint8_t mode = 2;
 
+    // LCD registers, STAT keeps the interrupt sources and the coincidence flag, the mode is added on reads
+    uint8_t lcdc = 0;
+    uint8_t stat = 0;
+    uint8_t scy = 0;
+    uint8_t scx = 0;
+    uint8_t ly = 0;
+    uint8_t lyc = 0;
+    uint8_t bgp = 0;
+    uint8_t obp0 = 0;
+    uint8_t obp1 = 0;
+    uint8_t wy = 0;
+    uint8_t wx = 0;
+
+    bool stat_line = false;
+
+    // shade of each color id, rebuilt when BGP, OBP0 or OBP1 are written
+    uint8_t bgp_shades[4] = { 0 };
+    uint8_t obp0_shades[4] = { 0 };
+    uint8_t obp1_shades[4] = { 0 };
+
+    // shade of a whole fifo entry with the palettes and the object priority applied,
+    // 256 entries so any byte indexes it
+    uint8_t fifo_shades[256] = { 0 };
+
+    // decoded from LCDC when it is written
+    uint16_t tile_data_address = 0x9000; // base of the background and window tiles, signed ids below 0x9000
+    uint16_t bg_map_address = 0x9800;
+    uint16_t window_map_address = 0x9800;
+
     uint16_t pause_time = 0;
     uint16_t internal_clock = 0;
     uint16_t fifo_clock = 0;
@@ -91,16 +185,37 @@ private:
     Fetcher sprite_fetcher;
 
 
-    uint8_t vram[0x2000]; // 0x8000-0x9FFF
+    // the back buffer is framebuffers[frame_count & 1]
+    uint8_t framebuffers[2][160 * 144];
+    std::atomic<uint64_t> frame_count{ 0 };
+
+    VideoMemory video_memory; // 0x8000-0x9FFF
     uint8_t oam[0xA0] = { 0 }; // 0xFE00-0xFE9F
 
-    Sprite object_buffer[40];
+    RenderThread* render_thread = nullptr;
+
+    // oam indices of the first 10 objects on each line, rebuilt after an object moves or LCDC.2 changes
+    uint8_t line_objects[144][10];
+    uint8_t line_object_counts[144];
+    bool line_objects_dirty = true;
+
+    Sprite object_buffer[10]; // objects on the current line sorted by x
     uint8_t object_count = 0;
+    uint8_t object_cursor = 0; // next object for the fetcher
 
-    FIFOPixel fifo[16] = { 0 };
+    // ring buffer, entry i of the queue is at (fifo_head + i) & (FIFO_SIZE - 1)
+    uint8_t fifo[FIFO_SIZE] = { 0 };
+    uint8_t fifo_head = 0;
     uint8_t fifo_pixel_count = 0;
 
     Sprite current_rendering_sprite = { 0 };
+
+    PPURenderMode line_render_mode = PPU_RENDER_FIFO;
+
+    bool skip_frame = false;
+    uint32_t skipped_frames = 0;
+    // segments are latched and logged during mode 3, the rest is filled in when the line is drawn
+    ScanlineJob line_job = { 0 };
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef EMULATOR_PIXEL_KERNELS_H_
+#define EMULATOR_PIXEL_KERNELS_H_
+
+#include <stdint.h>
+
+// Decodes one planar 2bpp tile row into 8 color ids (0-3), leftmost pixel first.
+// out_flipped receives the same row mirrored horizontally.
+typedef void (*DecodeTileRowKernel)(uint8_t low, uint8_t high, uint8_t* out, uint8_t* out_flipped);
+
+// Decodes row_count consecutive rows of planar tile data (low, high byte pairs)
+// into 8 color ids per row, several rows per step on the vector paths.
+typedef void (*DecodeTileRowsKernel)(const uint8_t* planar, uint32_t row_count, uint8_t* out, uint8_t* out_flipped);
+
+// Maps count color ids through a BGP/OBP0/OBP1 style palette to shades (0-3)
+typedef void (*MapPaletteKernel)(const uint8_t* ids, uint8_t palette, uint8_t* out, uint32_t count);
+
+// Replace count shades (0-3) with lut[shade], for 8, 16 and 32 bit pixel formats
+typedef void (*ExpandShades8Kernel)(const uint8_t* shades, const uint8_t* lut, uint8_t* out, uint32_t count);
+typedef void (*ExpandShades16Kernel)(const uint8_t* shades, const uint16_t* lut, uint16_t* out, uint32_t count);
+typedef void (*ExpandShades32Kernel)(const uint8_t* shades, const uint32_t* lut, uint32_t* out, uint32_t count);
+
+struct PixelKernels
+{
+    const char* name;
+    DecodeTileRowKernel decode_tile_row;
+    DecodeTileRowsKernel decode_tile_rows;
+    MapPaletteKernel map_palette;
+    ExpandShades8Kernel expand_shades_8;
+    ExpandShades16Kernel expand_shades_16;
+    ExpandShades32Kernel expand_shades_32;
+};
+
+// Best set for the host cpu, picked on the first call
+const PixelKernels& GetPixelKernels();
+
+// "scalar", "sse2" or "avx2", nullptr when the host cpu can't run that set
+const PixelKernels* FindPixelKernels(const char* name);
+
+enum ScreenFormat
+{
+    SCREEN_FORMAT_RGBA8888, // 4 bytes per pixel in R, G, B, A order
+    SCREEN_FORMAT_RGB565, // native endian uint16_t, red in the high bits
+    SCREEN_FORMAT_GRAY8 // 1 byte per pixel, luma of the color
+};
+
+// Shade colors as 0xRRGGBB, the greens the screen shader uses
+extern const uint32_t dmg_screen_colors[4];
+
+// Converts count shades (0-3) to the format, colors holds the 0xRRGGBB color of each shade.
+// out needs room for count pixels of the format.
+void ConvertShades(const uint8_t* shades, uint32_t count, ScreenFormat format, const uint32_t* colors, void* out);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef EMULATOR_PROFILER_H_
+#define EMULATOR_PROFILER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+class GameBoy;
+
+enum ProfilerMode
+{
+	PROFILE_EXACT, // every instruction adds its cycles
+	PROFILE_SAMPLED // the current instruction and stack get the period every sample_period cycles
+};
+
+struct ProfileEntry
+{
+	std::string location; // "BB:AAAA"
+	std::string symbol;
+	uint64_t cycles = 0; // self cycles
+	uint64_t total_cycles = 0; // including callees
+};
+
+// Attributes emulated cycles to (bank, PC) and to call stacks rebuilt from
+// CALL, RST and interrupt dispatch. Returns are detected through the stack
+// pointer so code that drops its return address does not corrupt the stack.
+// Costs a single branch per instruction while disabled.
+class Profiler
+{
+public:
+	Profiler(GameBoy* gameboy);
+	~Profiler();
+
+	// Clears all counters, symbols are kept
+	void Reset();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() { return this->enabled; }
+
+	void SetMode(ProfilerMode mode, uint32_t sample_period);
+	ProfilerMode GetMode() { return this->mode; }
+	uint32_t GetSamplePeriod() { return this->sample_period; }
+
+	// Called by the cpu after an instruction that started at pc with the stack pointer at sp
+	void OnInstruction(uint16_t pc, uint16_t sp, uint32_t cycles);
+
+	// Called by the cpu after it pushed the return address for an interrupt
+	void OnInterrupt(uint16_t vector);
+
+	uint64_t GetTotalCycles() { return this->total_cycles; }
+
+	std::vector<ProfileEntry> GetTopInstructions(size_t count);
+	std::vector<ProfileEntry> GetTopFunctions(size_t count);
+
+	// Reads an RGBDS symbol file ("BB:AAAA Name" per line)
+	bool LoadSymbols(const std::string& path);
+	void ClearSymbols() { this->symbols.clear(); }
+	size_t GetSymbolCount() { return this->symbols.size(); }
+
+	// Nearest symbol at or before the address in the same bank as "Name+$12", or an empty string
+	std::string GetSymbolName(uint16_t bank, uint16_t address);
+
+	// One "root;caller;callee cycles" line per call stack, the input format of flamegraph.pl
+	bool ExportCollapsedStacks(const std::string& path);
+private:
+	struct CallNode
+	{
+		uint32_t function; // bank << 16 | address
+		uint32_t parent;
+		uint64_t cycles;
+	};
+
+	struct CallFrame
+	{
+		uint32_t node;
+		uint16_t sp; // stack pointer right after the return address was pushed
+	};
+
+	uint16_t GetBank(uint16_t address);
+	uint32_t GetCounterIndex(uint16_t address);
+	void EnterFunction(uint16_t address, uint16_t sp);
+	std::string GetFunctionName(uint32_t function);
+
+	GameBoy* gb;
+
+	bool enabled = false;
+	ProfilerMode mode = PROFILE_EXACT;
+	uint32_t sample_period = 1000;
+	int64_t sample_countdown = 0;
+
+	uint64_t total_cycles = 0;
+
+	// rom offsets, followed by 0x8000-0xFFFF and the bootrom
+	std::vector<uint64_t> counters;
+	uint32_t rom_size = 0;
+
+	// call tree, node 0 is code that runs outside of any call
+	std::vector<CallNode> nodes;
+	std::unordered_map<uint64_t, uint32_t> children; // parent << 32 | function -> node
+	std::vector<CallFrame> frames;
+	uint32_t current_node = 0;
+
+	std::map<uint32_t, std::string> symbols; // bank << 16 | address
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef EMULATOR_REAL_TIME_CLOCK_H_
+#define EMULATOR_REAL_TIME_CLOCK_H_
+
+#include <stdint.h>
+#include <iostream>
+
+enum RTCClock
+{
+	RTC_CLOCK_EMULATED, // runs with the emulated cycles, stops while paused and speeds up with fast-forward
+	RTC_CLOCK_HOST // follows the host's wall clock, also while the emulator is closed
+};
+
+// Values selected through the MBC3 ram bank register
+enum RTCRegister
+{
+	RTC_SECONDS = 0x08,
+	RTC_MINUTES = 0x09,
+	RTC_HOURS = 0x0A,
+	RTC_DAY_LOW = 0x0B,
+	RTC_DAY_HIGH = 0x0C // bit 0: day bit 8, bit 6: halt, bit 7: day carry
+};
+
+#define RTC_SAVE_SIZE 48
+
+// MBC3 real time clock. Nothing is ticked, the counter is derived from the clock source when it
+// is latched or written: a stored count of seconds plus the whole seconds since it was stored.
+class RealTimeClock
+{
+public:
+	RealTimeClock();
+
+	// cycle_counter counts emulated M-cycles, only read with RTC_CLOCK_EMULATED
+	void SetClock(RTCClock clock, const uint64_t* cycle_counter);
+	RTCClock GetClock() { return this->clock; }
+
+	// Copies the counter to the registers the game reads
+	void Latch();
+
+	uint8_t ReadRegister(uint8_t reg);
+	void WriteRegister(uint8_t reg, uint8_t value);
+
+	// The 48 byte footer other emulators append to .sav files: the counter and the latched
+	// registers as 32 bit values (seconds, minutes, hours, day low, day high), then the unix time
+	void Save(std::ostream& file);
+
+	// Also reads the 44 byte variant with a 32 bit unix time. With RTC_CLOCK_HOST the time
+	// since the save was written is added.
+	bool Load(std::istream& file, size_t size);
+private:
+	uint64_t GetTicks();
+	uint64_t GetTicksPerSecond();
+
+	// Adds the whole seconds since base_ticks to base_seconds and wraps it after 512 days
+	void Rebase();
+
+	void GetRegisters(uint64_t seconds, uint8_t* registers);
+
+	RTCClock clock = RTC_CLOCK_EMULATED;
+	const uint64_t* cycle_counter = nullptr;
+
+	uint64_t base_seconds = 0; // counter value at base_ticks
+	uint64_t base_ticks = 0;
+	bool halted = false;
+	bool carry = false;
+
+	uint8_t latched[5] = { 0 };
+};
+
+#endif
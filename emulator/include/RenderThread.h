@@ -0,0 +1,79 @@
+#ifndef EMULATOR_RENDER_THREAD_H_
+#define EMULATOR_RENDER_THREAD_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ScanlineRenderer.h"
+#include "VideoMemory.h"
+
+#define RENDER_THREAD_JOB_COUNT 256 // power of two, indices wrap with a mask
+#define RENDER_THREAD_WRITE_COUNT 0x4000 // power of two
+
+// Draws scanline jobs on a worker thread. The worker keeps its own copy of vram, the
+// emulation thread forwards every vram write that changes a byte and each job records
+// how many writes came before it, so lines see vram exactly as it was when they were queued.
+// Both queues are single producer, single consumer rings, only QueueVRAMWrite, QueueLine,
+// WaitIdle and SyncVideoMemory may be called and only from the emulation thread.
+class RenderThread
+{
+public:
+    // Starts the worker with a copy of memory
+    RenderThread(const VideoMemory& memory);
+
+    // Draws the queued lines, then stops the worker
+    ~RenderThread();
+
+    void QueueVRAMWrite(uint16_t offset, uint8_t data);
+
+    // line must stay untouched until WaitIdle returns
+    void QueueLine(const ScanlineJob& job, uint8_t* line);
+
+    // Waits until every queued line is drawn and every write applied
+    void WaitIdle();
+
+    // Replaces the worker's vram, after WaitIdle
+    void SyncVideoMemory(const VideoMemory& memory);
+private:
+    struct LineSlot
+    {
+        ScanlineJob job;
+        uint8_t* line;
+        uint32_t write_end; // writes queued before this line
+    };
+
+    struct VRAMWrite
+    {
+        uint16_t offset;
+        uint8_t data;
+    };
+
+    void Run();
+    void ApplyWrites(uint32_t end);
+    void Wake();
+
+    const PixelKernels* kernels;
+    VideoMemory memory; // only touched by the worker while it runs
+
+    LineSlot lines[RENDER_THREAD_JOB_COUNT];
+    VRAMWrite writes[RENDER_THREAD_WRITE_COUNT];
+
+    // heads are advanced by the worker, tails by the emulation thread. Free running, masked on use.
+    std::atomic<uint32_t> line_head{ 0 };
+    std::atomic<uint32_t> line_tail{ 0 };
+    std::atomic<uint32_t> write_head{ 0 };
+    std::atomic<uint32_t> write_tail{ 0 };
+
+    // the worker only sleeps on the condition variable once both queues are empty
+    std::mutex mutex;
+    std::condition_variable wake_condition;
+    std::atomic<bool> sleeping{ false };
+    bool stop = false;
+
+    std::thread worker;
+};
+
+#endif
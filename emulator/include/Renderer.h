@@ -35,6 +35,7 @@ private:
     GLuint vao;
 	GLuint vbo;
 	GLuint screen_buffer;
+	uint64_t uploaded_frame = UINT64_MAX;
 
     GLuint screen_shader;
 };
@@ -0,0 +1,56 @@
+#ifndef EMULATOR_SCANLINE_RENDERER_H_
+#define EMULATOR_SCANLINE_RENDERER_H_
+
+#include <stdint.h>
+
+#include "PixelKernels.h"
+#include "VideoMemory.h"
+
+struct Sprite
+{
+    uint8_t y_pos;
+    uint8_t x_pos;
+    uint8_t tile;
+    uint8_t flags;
+};
+
+// Registers the scanline renderer draws with, latched when mode 3 starts
+struct ScanlineRegisters
+{
+    uint8_t lcdc;
+    uint8_t scy;
+    uint8_t scx;
+    uint8_t wy;
+    uint8_t wx;
+    uint8_t bgp;
+    uint8_t obp0;
+    uint8_t obp1;
+};
+
+// Registers from an x position of the line on, a write in the middle of mode 3 starts a new segment
+struct ScanlineSegment
+{
+    uint8_t x;
+    ScanlineRegisters registers;
+};
+
+#define SCANLINE_MAX_SEGMENTS 16
+
+// Everything a line is drawn from besides vram, so it can be drawn after the ppu moved on
+struct ScanlineJob
+{
+    uint8_t ly;
+    uint16_t window_line; // line of the window drawn on this line
+    bool window_reached; // WY matched LY on this or an earlier line of the frame
+
+    ScanlineSegment segments[SCANLINE_MAX_SEGMENTS];
+    uint8_t segment_count;
+
+    Sprite objects[10]; // sorted by x, oam order breaks ties
+    uint8_t object_count;
+};
+
+// Draws the 160 shades of a line
+void RenderScanline(VideoMemory& memory, const ScanlineJob& job, const PixelKernels& kernels, uint8_t* line);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef EMULATOR_VIDEO_MEMORY_H_
+#define EMULATOR_VIDEO_MEMORY_H_
+
+#include <stdint.h>
+
+#include "PixelKernels.h"
+
+#define TILE_DATA_SIZE 0x1800 // 384 tiles at 0x8000-0x97FF
+#define TILE_ROW_COUNT (TILE_DATA_SIZE / 2)
+
+// VRAM (0x8000-0x9FFF) with its tile data decoded to one byte per pixel.
+// Rows are decoded again after a write changes them.
+class VideoMemory
+{
+public:
+    VideoMemory();
+
+    void Reset();
+
+    uint8_t Read(uint16_t offset) { return this->vram[offset]; }
+
+    // Returns whether the byte changed
+    bool Write(uint16_t offset, uint8_t data);
+
+    // Color ids (0-3) of the 8 pixels of a tile row, offset is the row's position in vram
+    // (tile * 0x10 + row * 2). Flipped returns the row mirrored horizontally.
+    const uint8_t* GetTileRow(uint16_t offset, bool flipped);
+
+    // Decodes every dirty tile row
+    void FlushTileCache();
+
+    const uint8_t* GetData() { return this->vram; }
+private:
+    void DecodeTileRow(uint16_t row);
+
+    const PixelKernels* kernels;
+
+    uint8_t vram[0x2000];
+
+    uint8_t tile_cache[TILE_ROW_COUNT][8];
+    uint8_t tile_cache_flipped[TILE_ROW_COUNT][8];
+    uint64_t tile_dirty_rows[TILE_ROW_COUNT / 64];
+};
+
+#endif
@@ -12,6 +12,7 @@ Application::Application()
 
 Application::~Application()
 {
+	delete this->disassembler;
 	delete this->renderer;
 	delete this->gameboy;
 
@@ -49,6 +50,8 @@ int Application::Initialize()
 	this->gameboy = new GameBoy();
 
 	this->renderer = new Renderer();
+
+	this->disassembler = new Disassembler(this->gameboy);
 	return 0;
 }
 
@@ -142,18 +145,10 @@ void Application::Run()
 			{
 				cycle_count *= dt;
 			}
-			for(int i = 0; i < cycle_count; i++)
+
+			if (this->gameboy->Run(cycle_count))
 			{
-				this->gameboy->Update(dt);
-				
-				for(int i = 0; i < this->breakpoints.size(); i++)
-				{
-					if(this->gameboy->cpu->registers.PC == this->breakpoints[i])
-					{
-						paused = true;
-						break;
-					}
-				}
+				paused = true;
 			}
 		}
 
@@ -192,6 +187,25 @@ void Application::ConfigureImGui()
 	ImGui_ImplOpenGL3_Init("#version 430 core");
 }
 
+bool ParseAddress(const char* text, uint16_t& address)
+{
+	if (text[0] == '$')
+	{
+		text++;
+	}
+
+	char* end = nullptr;
+	unsigned long value = strtoul(text, &end, 16);
+
+	if (end == text || *end != '\0' || value > 0xFFFF)
+	{
+		return false;
+	}
+
+	address = (uint16_t)value;
+	return true;
+}
+
 inline bool DrawTabButton(const char* label, bool selected)
 {
 	ImGuiStyle& style = ImGui::GetStyle();
@@ -255,9 +269,38 @@ void Application::RenderGUI()
 						std::string rom_path = files[0];
 						std::cout << "Opening ROM: " << rom_path << std::endl;
 						this->gameboy->LoadROM(rom_path);
+						this->disassembler->Invalidate();
 					}
 				}
 				
+				bool host_clock = this->gameboy->GetRTCClock() == RTC_CLOCK_HOST;
+				if (ImGui::MenuItem("Cartridge clock follows the host clock", nullptr, &host_clock))
+				{
+					this->gameboy->SetRTCClock(host_clock ? RTC_CLOCK_HOST : RTC_CLOCK_EMULATED);
+				}
+
+				ImGui::EndMenu();
+			}
+
+			if(ImGui::BeginMenu("Video"))
+			{
+				bool scanline_renderer = this->gameboy->ppu->render_mode == PPU_RENDER_SCANLINE;
+				if (ImGui::MenuItem("Scanline renderer", nullptr, &scanline_renderer))
+				{
+					this->gameboy->ppu->render_mode = scanline_renderer ? PPU_RENDER_SCANLINE : PPU_RENDER_FIFO;
+				}
+
+				bool render_thread = this->gameboy->ppu->IsRenderThreadEnabled();
+				if (ImGui::MenuItem("Render on a worker thread", nullptr, &render_thread, scanline_renderer))
+				{
+					this->gameboy->ppu->SetRenderThread(render_thread);
+				}
+
+				int frame_skip = this->gameboy->ppu->frame_skip;
+				if (ImGui::SliderInt("Frame skip", &frame_skip, 0, 9))
+				{
+					this->gameboy->ppu->frame_skip = frame_skip;
+				}
 				ImGui::EndMenu();
 			}
 
@@ -267,6 +310,8 @@ void Application::RenderGUI()
 				ImGui::MenuItem("Toggle Disassembly", nullptr, &show_disassembly);
 				ImGui::MenuItem("Toggle Breakpoints", nullptr, &show_breakpoints);
 				ImGui::MenuItem("Toggle VRAM view", nullptr, &show_vram_view);
+				ImGui::MenuItem("Toggle Code/Data Logger", nullptr, &show_code_data_logger);
+				ImGui::MenuItem("Toggle Profiler", nullptr, &show_profiler);
 				ImGui::EndMenu();
 			}
 
@@ -396,8 +441,8 @@ void Application::RenderGUI()
 			gameboy->cpu->get_half_carry_flag(), 
 			gameboy->cpu->get_carry_flag());
 
-		uint8_t IE = this->gameboy->mmu->Read(0xFFFF);
-		uint8_t IF = this->gameboy->mmu->Read(0xFF0F);
+		uint8_t IE = this->gameboy->mmu->Peek(0xFFFF);
+		uint8_t IF = this->gameboy->mmu->Peek(0xFF0F);
 
 		ImGui::Text("IE: 0x%02X", IE);
 		ImGui::Text("IF: 0x%02X", IF);
@@ -410,8 +455,8 @@ void Application::RenderGUI()
 			ImGui::Text("HALTED: false");
 		}
 		
-		ImGui::Text("TIMA: %u", gameboy->mmu->Read(0xFF05));
-		ImGui::Text("DIV: %u", gameboy->mmu->Read(0xFF04));
+		ImGui::Text("TIMA: %u", gameboy->mmu->Peek(0xFF05));
+		ImGui::Text("DIV: %u", gameboy->mmu->Peek(0xFF04));
 
 		ImGui::End();
 	}
@@ -447,41 +492,75 @@ void Application::RenderGUI()
 				}
 			}
 
+			ImGui::SameLine();
+
+			bool scroll_to_pc = ImGui::Button("Go to PC");
+
 			ImGui::Separator();
+
+			this->disassembler->Update();
+
 			ImGui::BeginTable("Opcodes", 3, ImGuiTableFlags_PadOuterX | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_ScrollX);
 
 			ImGui::TableSetupColumn("Address");
-			ImGui::TableSetupColumn("Length");
+			ImGui::TableSetupColumn("Bytes");
 			ImGui::TableSetupColumn("Opcode");
+			ImGui::TableSetupScrollFreeze(0, 1);
 			ImGui::TableHeadersRow();
 
-			uint32_t i = 0;
-			while(i <= 0xFFFF)
+			uint16_t pc = this->gameboy->cpu->registers.PC;
+
+			if (scroll_to_pc)
 			{
-				ImGui::TableNextRow();
+				float row_height = ImGui::GetTextLineHeightWithSpacing();
+				ImGui::SetScrollY(this->disassembler->FindRow(pc) * row_height - ImGui::GetWindowHeight() * 0.5f);
+			}
 
-				ImGui::TableSetColumnIndex(0);
+			// only the visible rows are formatted and drawn
+			ImGuiListClipper clipper;
+			clipper.Begin((int)this->disassembler->GetRowCount());
+			while (clipper.Step())
+			{
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+				{
+					const DisassemblyRow& row = this->disassembler->GetRow(i);
 
-				ImGui::Selectable("", i == this->gameboy->cpu->registers.PC, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick);
+					char address_text[16];
+					char instruction_text[48];
+					this->disassembler->FormatAddress(row, address_text, sizeof(address_text));
+					this->disassembler->FormatInstruction(row, instruction_text, sizeof(instruction_text));
 
-				uint8_t op = this->gameboy->mmu->Read(i);
-				std::string& str = opcode_names[op];
-				uint8_t len = opcode_lengths[op];
-				if(op == 0xCB)
-				{
-					op = this->gameboy->mmu->Read(i + 1);
-					str = opcode_cb_names[op];
-				}
+					ImGui::TableNextRow();
+					ImGui::TableSetColumnIndex(0);
 
-				ImGui::SameLine();
+					ImGui::PushID(i);
+					ImGui::Selectable("", row.address == pc, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick);
+					ImGui::PopID();
 
-				ImGui::Text("0x%04X", i);
-				ImGui::TableNextColumn();
-				ImGui::Text("%u", len);
-				ImGui::TableNextColumn();
-				ImGui::Text(str.c_str());
+					ImGui::SameLine();
+
+					ImGui::Text("%s", address_text);
+					ImGui::TableNextColumn();
+
+					if (row.length == 1)
+					{
+						ImGui::Text("%02X", row.bytes[0]);
+					}
+					else if (row.length == 2)
+					{
+						ImGui::Text("%02X %02X", row.bytes[0], row.bytes[1]);
+					}
+					else
+					{
+						ImGui::Text("%02X %02X %02X", row.bytes[0], row.bytes[1], row.bytes[2]);
+					}
 
-				i += len;
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", instruction_text);
+				}
+
+				// rows whose bytes changed get decoded again on the next frame
+				this->disassembler->Validate(clipper.DisplayStart, clipper.DisplayEnd);
 			}
 
 			ImGui::EndTable();
@@ -494,17 +573,45 @@ void Application::RenderGUI()
 	{
 		ImGui::Begin("Breakpoints");
 
+		Debugger* debugger = this->gameboy->debugger;
+
+		if (paused && debugger->break_requested)
+		{
+			if (debugger->last_hit_was_watchpoint)
+			{
+				ImGui::Text("Stopped by watchpoint at 0x%04X", debugger->last_hit_address);
+			}
+			else
+			{
+				ImGui::Text("Stopped by breakpoint at 0x%04X", debugger->last_hit_address);
+			}
+		}
+
 		ImGui::ListBoxHeader("Addresses");
 		
-		for(int i = 0; i < this->breakpoints.size(); i++)
+		for(size_t i = 0; i < debugger->breakpoints.size(); i++)
 		{
-			if(i == this->current_breakpoint_item)
+			Breakpoint& bp = debugger->breakpoints[i];
+			const char* marker = (i == this->current_breakpoint_item) ? "*" : "";
+
+			if (bp.bank == BREAKPOINT_ANY_BANK)
 			{
-				ImGui::Text("*0x%04X", this->breakpoints[i]);
+				ImGui::Text("%s0x%04X", marker, bp.address);
 			}
 			else
 			{
-				ImGui::Text("0x%04X", this->breakpoints[i]);
+				ImGui::Text("%s%02X:0x%04X", marker, bp.bank, bp.address);
+			}
+
+			ImGui::SameLine();
+
+			if (bp.condition.IsEmpty())
+			{
+				ImGui::Text("(hits: %u)", bp.hit_count);
+			}
+			else
+			{
+				ImGui::Text("if %s (hits: %u)", bp.condition.source.c_str(), bp.hit_count);
 			}
 		}
 		
@@ -513,7 +620,7 @@ void Application::RenderGUI()
 		if(ImGui::Button("Previous"))
 		{
 			this->current_breakpoint_item -= 1;
-			if(this->current_breakpoint_item > this->breakpoints.size()-1)
+			if(this->current_breakpoint_item > debugger->breakpoints.size()-1)
 			{
 				this->current_breakpoint_item = 0;
 			}
@@ -524,44 +631,308 @@ void Application::RenderGUI()
 		if(ImGui::Button("Next"))
 		{
 			this->current_breakpoint_item += 1;
-			if(this->current_breakpoint_item > this->breakpoints.size()-1)
+			if(this->current_breakpoint_item > debugger->breakpoints.size()-1)
 			{
-				this->current_breakpoint_item = this->breakpoints.size() - 1;
+				this->current_breakpoint_item = debugger->breakpoints.size() - 1;
 			}
 		}
 
-		ImGui::InputText("Address", this->hex_val.data(), 5 * sizeof(char));
+		ImGui::InputText("Address", this->breakpoint_address, sizeof(this->breakpoint_address), ImGuiInputTextFlags_CharsHexadecimal);
+		ImGui::InputInt("Bank (-1 = any)", &this->breakpoint_bank);
+		ImGui::InputText("Condition", this->breakpoint_condition, sizeof(this->breakpoint_condition));
 
 		if(ImGui::Button("Add"))
 		{
-			uint16_t val = 0;
-			int mult = 1;
+			uint16_t address = 0;
+			BreakpointCondition condition;
 
-			for(int i = this->hex_val.size() - 1; i >= 0; i--)
+			if (!ParseAddress(this->breakpoint_address, address))
 			{
-				int d = 0;
-				if(this->hex_val[i] >= '0' && this->hex_val[i] <= '9')
-				{
-					d = std::clamp(this->hex_val[i] - '0', 0, 10);
-				}
-				else if(this->hex_val[i] >= 'A' && this->hex_val[i] <= 'F')
-				{
-					d = std::clamp(this->hex_val[i] - 'A', 0, 10) + 10;
-				}
-				
-				val += d * mult;
-				mult *= 0x10;
+				this->breakpoint_error = "Invalid address";
+			}
+			else if (!condition.Compile(this->breakpoint_condition))
+			{
+				this->breakpoint_error = condition.error;
+			}
+			else
+			{
+				this->breakpoint_error.clear();
+				debugger->AddBreakpoint(address, std::max(this->breakpoint_bank, BREAKPOINT_ANY_BANK), condition);
 			}
-
-			this->AddBreakpoint(val);
 		}
 		
 		ImGui::SameLine();
 
-		if(ImGui::Button("Remove") && this->breakpoints.size() > 0)
+		if(ImGui::Button("Remove") && debugger->breakpoints.size() > 0)
+		{
+			debugger->RemoveBreakpoint(this->current_breakpoint_item);
+			if (this->current_breakpoint_item >= debugger->breakpoints.size() && this->current_breakpoint_item > 0)
+			{
+				this->current_breakpoint_item--;
+			}
+		}
+
+		if (!this->breakpoint_error.empty())
+		{
+			ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", this->breakpoint_error.c_str());
+		}
+
+		ImGui::Separator();
+
+		ImGui::ListBoxHeader("Watchpoints");
+
+		for(size_t i = 0; i < debugger->watchpoints.size(); i++)
+		{
+			Watchpoint& wp = debugger->watchpoints[i];
+
+			ImGui::Text("%s0x%04X %s%s", (i == this->current_watchpoint_item) ? "*" : "", wp.address,
+				(wp.type & WATCH_READ) ? "R" : "",
+				(wp.type & WATCH_WRITE) ? "W" : "");
+		}
+
+		ImGui::EndListBox();
+
+		if(ImGui::Button("Previous##watch") && this->current_watchpoint_item > 0)
+		{
+			this->current_watchpoint_item -= 1;
+		}
+
+		ImGui::SameLine();
+
+		if(ImGui::Button("Next##watch") && this->current_watchpoint_item + 1 < debugger->watchpoints.size())
+		{
+			this->current_watchpoint_item += 1;
+		}
+
+		ImGui::InputText("Address##watch", this->watch_address, sizeof(this->watch_address), ImGuiInputTextFlags_CharsHexadecimal);
+		ImGui::Checkbox("Read", &this->watch_read);
+		ImGui::SameLine();
+		ImGui::Checkbox("Write", &this->watch_write);
+
+		if(ImGui::Button("Add##watch") && (this->watch_read || this->watch_write))
+		{
+			uint16_t address = 0;
+			if (ParseAddress(this->watch_address, address))
+			{
+				uint8_t type = (this->watch_read ? WATCH_READ : 0) | (this->watch_write ? WATCH_WRITE : 0);
+				debugger->AddWatchpoint(address, type);
+			}
+		}
+
+		ImGui::SameLine();
+
+		if(ImGui::Button("Remove##watch") && debugger->watchpoints.size() > 0)
 		{
-			this->RemoveBreakpoint(this->current_breakpoint_item);
-			this->current_breakpoint_item %= (this->breakpoints.size() - 1);
+			debugger->RemoveWatchpoint(this->current_watchpoint_item);
+			if (this->current_watchpoint_item >= debugger->watchpoints.size() && this->current_watchpoint_item > 0)
+			{
+				this->current_watchpoint_item--;
+			}
+		}
+
+		ImGui::End();
+	}
+
+	if(show_code_data_logger)
+	{
+		ImGui::Begin("Code/Data Logger", &show_code_data_logger);
+
+		CodeDataLogger* cdl = this->gameboy->cdl;
+
+		bool enabled = cdl->IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+		{
+			cdl->SetEnabled(enabled);
+		}
+
+		// counting walks the whole rom, so only refresh it once a second
+		this->cdl_refresh_timer -= this->dt;
+		if (this->cdl_refresh_timer <= 0.0f)
+		{
+			this->cdl_refresh_timer = 1.0f;
+			this->cdl_coverage = cdl->GetCoverage();
+		}
+
+		CDLCoverage& c = this->cdl_coverage;
+		float total = (c.rom_size > 0) ? (float)c.rom_size : 1.0f;
+
+		ImGui::Text("ROM size: %u bytes", c.rom_size);
+		ImGui::Text("Code: %u (%.2f%%)", c.code_bytes, 100.0f * c.code_bytes / total);
+		ImGui::Text("Operands: %u (%.2f%%)", c.operand_bytes, 100.0f * c.operand_bytes / total);
+		ImGui::Text("Data: %u (%.2f%%)", c.data_bytes, 100.0f * c.data_bytes / total);
+		ImGui::Text("Covered: %u (%.2f%%)", c.touched_bytes, 100.0f * c.touched_bytes / total);
+
+		if (ImGui::Button("Export"))
+		{
+			auto f = pfd::save_file("Export CDL", pfd::path::home(),
+			{ "Code/Data Log (.cdl)", "*.cdl" },
+			pfd::opt::none);
+
+			if (!f.result().empty())
+			{
+				cdl->Export(f.result());
+			}
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Import"))
+		{
+			auto f = pfd::open_file("Import CDL", pfd::path::home(),
+			{ "Code/Data Log (.cdl)", "*.cdl",
+			"All Files", "*" },
+			pfd::opt::none);
+
+			std::vector<std::string> files = f.result();
+			if (!files.empty())
+			{
+				cdl->Import(files[0]);
+				this->cdl_refresh_timer = 0.0f;
+			}
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Clear"))
+		{
+			cdl->Reset();
+			this->cdl_refresh_timer = 0.0f;
+		}
+
+		ImGui::End();
+	}
+
+	if(show_profiler)
+	{
+		ImGui::Begin("Profiler", &show_profiler);
+
+		Profiler* profiler = this->gameboy->profiler;
+
+		bool enabled = profiler->IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+		{
+			profiler->SetEnabled(enabled);
+		}
+
+		ImGui::SameLine();
+
+		int mode = profiler->GetMode();
+		int sample_period = profiler->GetSamplePeriod();
+		bool mode_changed = ImGui::RadioButton("Exact", &mode, PROFILE_EXACT);
+		ImGui::SameLine();
+		mode_changed |= ImGui::RadioButton("Sampled", &mode, PROFILE_SAMPLED);
+
+		if (mode == PROFILE_SAMPLED)
+		{
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(100.0f);
+			mode_changed |= ImGui::InputInt("Period", &sample_period, 100, 1000);
+		}
+
+		if (mode_changed)
+		{
+			profiler->SetMode((ProfilerMode)mode, (uint32_t)std::max(sample_period, 1));
+		}
+
+		if (ImGui::Button("Load Symbols"))
+		{
+			auto f = pfd::open_file("Load symbols", pfd::path::home(),
+			{ "RGBDS Symbols (.sym)", "*.sym",
+			"All Files", "*" },
+			pfd::opt::none);
+
+			std::vector<std::string> files = f.result();
+			if (!files.empty())
+			{
+				profiler->LoadSymbols(files[0]);
+				this->profiler_refresh_timer = 0.0f;
+			}
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Export Stacks"))
+		{
+			auto f = pfd::save_file("Export collapsed stacks", pfd::path::home(),
+			{ "Collapsed Stacks (.folded)", "*.folded" },
+			pfd::opt::none);
+
+			if (!f.result().empty())
+			{
+				profiler->ExportCollapsedStacks(f.result());
+			}
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Clear"))
+		{
+			profiler->Reset();
+			this->profiler_refresh_timer = 0.0f;
+		}
+
+		ImGui::Text("Symbols: %zu", profiler->GetSymbolCount());
+
+		ImGui::Checkbox("Group by function", &this->profiler_by_function);
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(100.0f);
+		ImGui::SliderInt("Rows", &this->profiler_rows, 10, 100);
+
+		// sorting walks every counter, so only refresh the table twice a second
+		this->profiler_refresh_timer -= this->dt;
+		if (this->profiler_refresh_timer <= 0.0f)
+		{
+			this->profiler_refresh_timer = 0.5f;
+			this->profiler_total_cycles = profiler->GetTotalCycles();
+
+			if (this->profiler_by_function)
+			{
+				this->profiler_entries = profiler->GetTopFunctions(this->profiler_rows);
+			}
+			else
+			{
+				this->profiler_entries = profiler->GetTopInstructions(this->profiler_rows);
+			}
+		}
+
+		ImGui::Text("Total: %llu cycles", (unsigned long long)this->profiler_total_cycles);
+
+		int column_count = this->profiler_by_function ? 5 : 4;
+		if (ImGui::BeginTable("Hot spots", column_count, ImGuiTableFlags_PadOuterX | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Address");
+			ImGui::TableSetupColumn("Symbol");
+			ImGui::TableSetupColumn("Cycles");
+			ImGui::TableSetupColumn("Self %");
+			if (this->profiler_by_function)
+			{
+				ImGui::TableSetupColumn("Total %");
+			}
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableHeadersRow();
+
+			double total = (this->profiler_total_cycles > 0) ? (double)this->profiler_total_cycles : 1.0;
+
+			for (const ProfileEntry& entry : this->profiler_entries)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::Text("%s", entry.location.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", entry.symbol.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", (unsigned long long)entry.cycles);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", 100.0 * entry.cycles / total);
+
+				if (this->profiler_by_function)
+				{
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", 100.0 * entry.total_cycles / total);
+				}
+			}
+
+			ImGui::EndTable();
 		}
 
 		ImGui::End();
@@ -572,14 +943,4 @@ void Application::RenderGUI()
 	int display_w, display_h;
 	glfwGetFramebufferSize(window, &display_w, &display_h);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-}
-
-void Application::AddBreakpoint(uint16_t address)
-{
-	this->breakpoints.push_back(address);
-}
-
-void Application::RemoveBreakpoint(uint16_t index)
-{
-	this->breakpoints.erase(this->breakpoints.begin() + index);
 }
\ No newline at end of file
@@ -0,0 +1,445 @@
+#include "BreakpointCondition.h"
+#include "GameBoy.h"
+
+#include <cctype>
+
+struct BinaryOperator
+{
+	const char* text;
+	int level;
+	ConditionOp op;
+};
+
+static const BinaryOperator binary_operators[] = {
+	{ "||", 0, COND_LOGICAL_OR },
+	{ "&&", 1, COND_LOGICAL_AND },
+	{ "|", 2, COND_BIT_OR },
+	{ "^", 3, COND_BIT_XOR },
+	{ "&", 4, COND_BIT_AND },
+	{ "==", 5, COND_EQUAL },
+	{ "!=", 5, COND_NOT_EQUAL },
+	{ "<", 5, COND_LESS },
+	{ "<=", 5, COND_LESS_EQUAL },
+	{ ">", 5, COND_GREATER },
+	{ ">=", 5, COND_GREATER_EQUAL },
+	{ "+", 6, COND_ADD },
+	{ "-", 6, COND_SUB }
+};
+
+#define BINARY_LEVEL_COUNT 7
+
+struct RegisterName
+{
+	const char* name;
+	ConditionRegister reg;
+};
+
+static const RegisterName register_names[] = {
+	{ "A", COND_REG_A }, { "F", COND_REG_F }, { "B", COND_REG_B }, { "C", COND_REG_C },
+	{ "D", COND_REG_D }, { "E", COND_REG_E }, { "H", COND_REG_H }, { "L", COND_REG_L },
+	{ "AF", COND_REG_AF }, { "BC", COND_REG_BC }, { "DE", COND_REG_DE }, { "HL", COND_REG_HL },
+	{ "SP", COND_REG_SP }, { "PC", COND_REG_PC },
+	{ "ZF", COND_FLAG_Z }, { "NF", COND_FLAG_N }, { "HF", COND_FLAG_H }, { "CF", COND_FLAG_C }
+};
+
+bool BreakpointCondition::Compile(const std::string& source)
+{
+	this->source = source;
+	this->error.clear();
+	this->program.clear();
+
+	this->position = 0;
+	this->stack_depth = 0;
+	this->max_stack_depth = 0;
+
+	bool result = this->Tokenize(source);
+
+	if (result && this->tokens.size() > 1)
+	{
+		result = this->ParseBinary(0);
+
+		if (result && this->tokens[this->position].type != Token::END)
+		{
+			this->error = "Unexpected '" + this->tokens[this->position].text + "'";
+			result = false;
+		}
+
+		if (result && this->max_stack_depth > CONDITION_MAX_STACK)
+		{
+			this->error = "Expression is too complex";
+			result = false;
+		}
+	}
+
+	if (!result)
+	{
+		this->program.clear();
+	}
+
+	this->tokens.clear();
+	return result;
+}
+
+bool BreakpointCondition::Tokenize(const std::string& text)
+{
+	this->tokens.clear();
+
+	size_t i = 0;
+	while (i < text.size())
+	{
+		char c = text[i];
+
+		if (isspace((unsigned char)c))
+		{
+			i++;
+			continue;
+		}
+
+		Token token;
+		token.value = 0;
+
+		if (isdigit((unsigned char)c) || c == '$')
+		{
+			size_t start = i;
+			int base = 10;
+
+			if (c == '$')
+			{
+				base = 16;
+				i++;
+			}
+			else if (c == '0' && i + 1 < text.size() && (text[i + 1] == 'x' || text[i + 1] == 'X'))
+			{
+				base = 16;
+				i += 2;
+			}
+
+			size_t digits_start = i;
+			while (i < text.size() && isxdigit((unsigned char)text[i]))
+			{
+				i++;
+			}
+
+			token.type = Token::NUMBER;
+			token.text = text.substr(start, i - start);
+
+			std::string digits = text.substr(digits_start, i - digits_start);
+			char* end = nullptr;
+			unsigned long value = strtoul(digits.c_str(), &end, base);
+
+			if (digits.empty() || *end != '\0' || value > 0xFFFFFFFF)
+			{
+				this->error = "Invalid number '" + token.text + "'";
+				return false;
+			}
+
+			token.value = (int32_t)value;
+		}
+		else if (isalpha((unsigned char)c) || c == '_')
+		{
+			size_t start = i;
+			while (i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '_'))
+			{
+				i++;
+			}
+
+			token.type = Token::IDENTIFIER;
+			token.text = text.substr(start, i - start);
+		}
+		else
+		{
+			static const char* two_char_operators[] = { "||", "&&", "==", "!=", "<=", ">=" };
+			static const char* single_char_operators = "|^&<>+-!~()[]";
+
+			token.type = Token::OPERATOR;
+
+			for (const char* op : two_char_operators)
+			{
+				if (text.compare(i, 2, op) == 0)
+				{
+					token.text = op;
+					break;
+				}
+			}
+
+			if (token.text.empty())
+			{
+				if (strchr(single_char_operators, c) == nullptr)
+				{
+					this->error = std::string("Unexpected character '") + c + "'";
+					return false;
+				}
+
+				token.text = std::string(1, c);
+			}
+
+			i += token.text.size();
+		}
+
+		this->tokens.push_back(token);
+	}
+
+	Token end;
+	end.type = Token::END;
+	end.text = "end of expression";
+	end.value = 0;
+	this->tokens.push_back(end);
+
+	return true;
+}
+
+bool BreakpointCondition::ParseBinary(int level)
+{
+	if (level >= BINARY_LEVEL_COUNT)
+	{
+		return this->ParseUnary();
+	}
+
+	if (!this->ParseBinary(level + 1))
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		Token& token = this->tokens[this->position];
+		if (token.type != Token::OPERATOR)
+		{
+			return true;
+		}
+
+		const BinaryOperator* match = nullptr;
+		for (const BinaryOperator& op : binary_operators)
+		{
+			if (op.level == level && token.text == op.text)
+			{
+				match = &op;
+				break;
+			}
+		}
+
+		if (match == nullptr)
+		{
+			return true;
+		}
+
+		this->position++;
+
+		if (!this->ParseBinary(level + 1))
+		{
+			return false;
+		}
+
+		this->Emit(match->op);
+	}
+}
+
+bool BreakpointCondition::ParseUnary()
+{
+	Token& token = this->tokens[this->position];
+
+	if (token.type == Token::OPERATOR && (token.text == "!" || token.text == "-" || token.text == "~"))
+	{
+		ConditionOp op = COND_NOT;
+		if (token.text == "-")
+		{
+			op = COND_NEGATE;
+		}
+		else if (token.text == "~")
+		{
+			op = COND_COMPLEMENT;
+		}
+
+		this->position++;
+
+		if (!this->ParseUnary())
+		{
+			return false;
+		}
+
+		this->Emit(op);
+		return true;
+	}
+
+	return this->ParsePrimary();
+}
+
+bool BreakpointCondition::ParsePrimary()
+{
+	Token& token = this->tokens[this->position];
+
+	if (token.type == Token::NUMBER)
+	{
+		this->position++;
+		this->Emit(COND_PUSH, token.value);
+		return true;
+	}
+
+	if (token.type == Token::IDENTIFIER)
+	{
+		std::string name = token.text;
+		for (char& c : name)
+		{
+			c = toupper((unsigned char)c);
+		}
+
+		if (name == "HITS" || name == "HITCOUNT")
+		{
+			this->position++;
+			this->Emit(COND_HITS);
+			return true;
+		}
+
+		for (const RegisterName& reg : register_names)
+		{
+			if (name == reg.name)
+			{
+				this->position++;
+				this->Emit(COND_REGISTER, reg.reg);
+				return true;
+			}
+		}
+
+		this->error = "Unknown name '" + token.text + "'";
+		return false;
+	}
+
+	if (token.type == Token::OPERATOR && (token.text == "(" || token.text == "["))
+	{
+		bool memory = token.text == "[";
+		const char* closing = memory ? "]" : ")";
+
+		this->position++;
+
+		if (!this->ParseBinary(0))
+		{
+			return false;
+		}
+
+		if (this->tokens[this->position].text != closing)
+		{
+			this->error = std::string("Expected '") + closing + "'";
+			return false;
+		}
+
+		this->position++;
+
+		if (memory)
+		{
+			this->Emit(COND_READ);
+		}
+
+		return true;
+	}
+
+	this->error = "Unexpected '" + token.text + "'";
+	return false;
+}
+
+void BreakpointCondition::Emit(ConditionOp op, int32_t value)
+{
+	this->program.push_back({ op, value });
+
+	switch (op)
+	{
+	case COND_PUSH:
+	case COND_REGISTER:
+	case COND_HITS:
+		this->stack_depth++;
+		break;
+	case COND_READ:
+	case COND_NOT:
+	case COND_NEGATE:
+	case COND_COMPLEMENT:
+		break;
+	default:
+		this->stack_depth--;
+		break;
+	}
+
+	if (this->stack_depth > this->max_stack_depth)
+	{
+		this->max_stack_depth = this->stack_depth;
+	}
+}
+
+static int32_t ReadConditionRegister(CPU* cpu, int32_t reg)
+{
+	switch (reg)
+	{
+	case COND_REG_A: return cpu->registers.A;
+	case COND_REG_F: return cpu->registers.F;
+	case COND_REG_B: return cpu->registers.B;
+	case COND_REG_C: return cpu->registers.C;
+	case COND_REG_D: return cpu->registers.D;
+	case COND_REG_E: return cpu->registers.E;
+	case COND_REG_H: return cpu->registers.H;
+	case COND_REG_L: return cpu->registers.L;
+	case COND_REG_AF: return cpu->registers.AF;
+	case COND_REG_BC: return cpu->registers.BC;
+	case COND_REG_DE: return cpu->registers.DE;
+	case COND_REG_HL: return cpu->registers.HL;
+	case COND_REG_SP: return cpu->registers.SP;
+	case COND_REG_PC: return cpu->registers.PC;
+	case COND_FLAG_Z: return cpu->get_zero_flag();
+	case COND_FLAG_N: return cpu->get_subtraction_flag();
+	case COND_FLAG_H: return cpu->get_half_carry_flag();
+	case COND_FLAG_C: return cpu->get_carry_flag();
+	default:
+		return 0;
+	}
+}
+
+bool BreakpointCondition::Evaluate(GameBoy* gb, uint32_t hits)
+{
+	if (this->program.empty())
+	{
+		return true;
+	}
+
+	int32_t stack[CONDITION_MAX_STACK];
+	int32_t top = 0;
+
+	for (const ConditionInstruction& ins : this->program)
+	{
+		switch (ins.op)
+		{
+		case COND_PUSH: stack[top++] = ins.value; break;
+		case COND_REGISTER: stack[top++] = ReadConditionRegister(gb->cpu, ins.value); break;
+		case COND_HITS: stack[top++] = (int32_t)hits; break;
+		case COND_READ: stack[top - 1] = gb->mmu->Peek(stack[top - 1] & 0xFFFF); break;
+		case COND_NOT: stack[top - 1] = !stack[top - 1]; break;
+		case COND_NEGATE: stack[top - 1] = -stack[top - 1]; break;
+		case COND_COMPLEMENT: stack[top - 1] = ~stack[top - 1]; break;
+		default:
+		{
+			int32_t b = stack[--top];
+			int32_t a = stack[top - 1];
+			int32_t r = 0;
+
+			switch (ins.op)
+			{
+			case COND_ADD: r = a + b; break;
+			case COND_SUB: r = a - b; break;
+			case COND_EQUAL: r = a == b; break;
+			case COND_NOT_EQUAL: r = a != b; break;
+			case COND_LESS: r = a < b; break;
+			case COND_LESS_EQUAL: r = a <= b; break;
+			case COND_GREATER: r = a > b; break;
+			case COND_GREATER_EQUAL: r = a >= b; break;
+			case COND_BIT_AND: r = a & b; break;
+			case COND_BIT_XOR: r = a ^ b; break;
+			case COND_BIT_OR: r = a | b; break;
+			case COND_LOGICAL_AND: r = a && b; break;
+			case COND_LOGICAL_OR: r = a || b; break;
+			default: break;
+			}
+
+			stack[top - 1] = r;
+			break;
+		}
+		}
+	}
+
+	return stack[0] != 0;
+}
\ No newline at end of file
@@ -35,6 +35,11 @@ bool CPU::ProcessInterrupt(uint8_t interrupts_fired, uint8_t bit, uint8_t addres
 		SetInterruptFlag(bit, false);
 		this->registers.PC = address;
 		IME = false;
+
+		if (this->gb->profiler->IsEnabled())
+		{
+			this->gb->profiler->OnInterrupt(address);
+		}
 		return true;
 	}
 
@@ -183,10 +188,21 @@ void CPU::Tick()
 		uint32_t diff = this->cycles - start_cycles;
 		this->internal_clock += diff;
 		this->cycles %= CLOCK_SPEED;
+
+		if (this->gb->profiler->IsEnabled())
+		{
+			this->gb->profiler->OnInstruction(this->registers.PC, this->registers.SP, diff + 1);
+		}
 		return;
 	}
 
 	uint16_t start_pc = this->registers.PC;
+	uint16_t start_sp = this->registers.SP;
+
+	if (this->gb->cdl->IsEnabled())
+	{
+		this->gb->cdl->LogInstruction(start_pc);
+	}
 
 	uint8_t opcode = this->gb->mmu->Read(this->registers.PC);
 
@@ -269,5 +285,10 @@ void CPU::Tick()
 	uint32_t diff = this->cycles - start_cycles;
 	this->internal_clock += diff;
 	this->cycles %= CLOCK_SPEED;
+
+	if (this->gb->profiler->IsEnabled())
+	{
+		this->gb->profiler->OnInstruction(start_pc, start_sp, diff + 1);
+	}
 	//return diff;
 }
\ No newline at end of file
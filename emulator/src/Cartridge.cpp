@@ -1,15 +1,25 @@
 #include "Cartridge.h"
 
+#include <algorithm>
+#include <fstream>
+
 Mapper::Mapper(CartridgeHeader& header)
 {
 	// Get rom and ram size
-	uint64_t rom_size = 0x8000 * (1 << header.rom_size);
+	uint64_t rom_size = 0;
+	switch (header.rom_size)
+	{
+	case ROM_1_1MB: rom_size = 72 * 0x4000; break;
+	case ROM_1_2MB: rom_size = 80 * 0x4000; break;
+	case ROM_1_5MB: rom_size = 96 * 0x4000; break;
+	default: rom_size = 0x8000 << std::min<uint8_t>(header.rom_size, ROM_8MB); break;
+	}
 
 	uint64_t ram_size = 0;
 	switch (header.ram_size)
 	{
 	case RAM_NONE: ram_size = 0; break;
-	case RAM_8KB: ram_size = 8196; break;
+	case RAM_8KB: ram_size = 0x2000; break;
 	case RAM_32KB: ram_size = 32768; break;
 	case RAM_128KB: ram_size = 131072; break;
 	case RAM_64KB: ram_size = 65536; break;
@@ -31,6 +41,15 @@ Mapper::Mapper(CartridgeHeader& header)
 
 	this->allocated_rom_size = rom_size;
 	this->allocated_ram_size = ram_size;
+
+	this->Mapper::UpdateBanks();
+}
+
+void Mapper::UpdateBanks()
+{
+	this->rom0_bank = this->rom;
+	this->romx_bank = &this->rom[0x4000 * (this->rom_bank_number % std::max<uint16_t>(this->rom_bank_count, 1))];
+	this->ram_bank = (this->allocated_ram_size >= 0x2000) ? this->ram : nullptr;
 }
 
 Mapper::~Mapper()
@@ -61,17 +80,17 @@ void NoMBC::WriteROM(uint16_t address, uint8_t value)
 
 uint8_t NoMBC::ReadRAM(uint16_t address)
 {
-	return this->ram[address];
+	return this->ram[(address - 0xA000) % this->allocated_ram_size];
 }
 
 void NoMBC::WriteRAM(uint16_t address, uint8_t value)
 {
-	this->ram[address] = value;
+	this->ram[(address - 0xA000) % this->allocated_ram_size] = value;
 }
 
 MBC1::MBC1(CartridgeHeader& header) : Mapper(header)
 {
-
+	this->UpdateBanks();
 }
 
 MBC1::~MBC1()
@@ -120,12 +139,10 @@ void MBC1::WriteROM(uint16_t address, uint8_t value)
 
 		if (this->banking_mode)
 		{
-			if ((value & 0x03) >= this->ram_bank_count)
+			if ((value & 0x03) < this->ram_bank_count)
 			{
-				return;
+				this->ram_bank_number = (value & 0x03) & (this->ram_bank_count - 1);
 			}
-
-			this->ram_bank_number = (value & 0x03) & (this->ram_bank_count - 1);
 		}
 		else
 		{
@@ -142,6 +159,20 @@ void MBC1::WriteROM(uint16_t address, uint8_t value)
 	{
 		this->banking_mode = value & 0x01;
 	}
+
+	this->UpdateBanks();
+}
+
+void MBC1::UpdateBanks()
+{
+	this->Mapper::UpdateBanks();
+
+	// the ram bank register only applies in banking mode 1
+	this->ram_bank = nullptr;
+	if (this->ram_enabled && this->allocated_ram_size >= 0x2000)
+	{
+		this->ram_bank = &this->ram[0x2000 * (this->banking_mode * this->ram_bank_number)];
+	}
 }
 
 uint8_t MBC1::ReadRAM(uint16_t address)
@@ -167,6 +198,177 @@ void MBC1::WriteRAM(uint16_t address, uint8_t value)
 	}
 }
 
+MBC3::MBC3(CartridgeHeader& header) : Mapper(header)
+{
+	if (header.has_rtc)
+	{
+		this->rtc = new RealTimeClock();
+	}
+
+	this->UpdateBanks();
+}
+
+MBC3::~MBC3()
+{
+	delete this->rtc;
+}
+
+uint8_t MBC3::ReadROM(uint16_t address)
+{
+	if (address <= 0x3FFF)
+	{
+		return this->rom0_bank[address];
+	}
+
+	return this->romx_bank[address - 0x4000];
+}
+
+void MBC3::WriteROM(uint16_t address, uint8_t value)
+{
+	if (address <= 0x1FFF)
+	{
+		// enables the clock registers too
+		this->ram_enabled = (value & 0x0F) == 0xA;
+	}
+	else if (address <= 0x3FFF)
+	{
+		this->rom_bank_number = value & 0x7F;
+		if (this->rom_bank_number == 0)
+		{
+			this->rom_bank_number = 1;
+		}
+	}
+	else if (address <= 0x5FFF)
+	{
+		// 0x00-0x07 selects a ram bank, 0x08-0x0C a clock register
+		this->ram_bank_number = value & 0x0F;
+	}
+	else
+	{
+		if (this->latch_value == 0x00 && value == 0x01 && this->rtc != nullptr)
+		{
+			this->rtc->Latch();
+		}
+
+		this->latch_value = value;
+	}
+
+	this->UpdateBanks();
+}
+
+uint8_t MBC3::ReadRAM(uint16_t address)
+{
+	if (this->ram_bank != nullptr)
+	{
+		return this->ram_bank[address - 0xA000];
+	}
+
+	if (this->ram_enabled && this->rtc != nullptr && this->ram_bank_number >= RTC_SECONDS)
+	{
+		return this->rtc->ReadRegister(this->ram_bank_number);
+	}
+
+	return 0xFF;
+}
+
+void MBC3::WriteRAM(uint16_t address, uint8_t value)
+{
+	if (this->ram_bank != nullptr)
+	{
+		this->ram_bank[address - 0xA000] = value;
+	}
+	else if (this->ram_enabled && this->rtc != nullptr && this->ram_bank_number >= RTC_SECONDS)
+	{
+		this->rtc->WriteRegister(this->ram_bank_number, value);
+	}
+}
+
+void MBC3::UpdateBanks()
+{
+	this->Mapper::UpdateBanks();
+
+	// the clock registers are read through ReadRAM
+	this->ram_bank = nullptr;
+	if (this->ram_enabled && this->ram_bank_number < RTC_SECONDS && this->ram_bank_count > 0)
+	{
+		this->ram_bank = &this->ram[0x2000 * (this->ram_bank_number % this->ram_bank_count)];
+	}
+}
+
+MBC5::MBC5(CartridgeHeader& header) : Mapper(header)
+{
+	this->UpdateBanks();
+}
+
+MBC5::~MBC5()
+{
+
+}
+
+uint8_t MBC5::ReadROM(uint16_t address)
+{
+	if (address <= 0x3FFF)
+	{
+		return this->rom0_bank[address];
+	}
+
+	return this->romx_bank[address - 0x4000];
+}
+
+void MBC5::WriteROM(uint16_t address, uint8_t value)
+{
+	if (address <= 0x1FFF)
+	{
+		this->ram_enabled = (value & 0x0F) == 0xA;
+	}
+	else if (address <= 0x2FFF)
+	{
+		// low 8 bits of the 9 bit bank, bank 0 can be mapped at 0x4000 too
+		this->rom_bank_number = (this->rom_bank_number & 0x100) | value;
+	}
+	else if (address <= 0x3FFF)
+	{
+		this->rom_bank_number = (this->rom_bank_number & 0xFF) | ((value & 0x01) << 8);
+	}
+	else if (address <= 0x5FFF)
+	{
+		// bit 3 drives the motor on rumble cartridges
+		this->ram_bank_number = value & 0x0F;
+	}
+
+	this->UpdateBanks();
+}
+
+uint8_t MBC5::ReadRAM(uint16_t address)
+{
+	if (this->ram_bank == nullptr)
+	{
+		return 0xFF;
+	}
+
+	return this->ram_bank[address - 0xA000];
+}
+
+void MBC5::WriteRAM(uint16_t address, uint8_t value)
+{
+	if (this->ram_bank != nullptr)
+	{
+		this->ram_bank[address - 0xA000] = value;
+	}
+}
+
+void MBC5::UpdateBanks()
+{
+	this->Mapper::UpdateBanks();
+
+	// bank numbers past the end wrap around like the address lines do
+	this->ram_bank = nullptr;
+	if (this->ram_enabled && this->ram_bank_count > 0)
+	{
+		this->ram_bank = &this->ram[0x2000 * (this->ram_bank_number % this->ram_bank_count)];
+	}
+}
+
 Cartridge::Cartridge()
 {
 	
@@ -232,14 +434,21 @@ bool Cartridge::LoadROM(std::string path, uint8_t* rom, size_t data_size)
 		switch (this->header.cartridge_type)
 		{
 		case MBC1_TYPE: this->active_mapper = new MBC1(this->header); std::cout << "MBC1" << std::endl; break;
+		case MBC3_TYPE: this->active_mapper = new MBC3(this->header); std::cout << "MBC3" << std::endl; break;
+		case MBC5_TYPE: this->active_mapper = new MBC5(this->header); std::cout << "MBC5" << std::endl; break;
 		case ROM_ONLY:
 		default:
 			this->active_mapper = new NoMBC(this->header);
 			break;
 		}
 
-		// Copy contents to the allocated memory
-		memcpy(this->active_mapper->rom, rom, data_size);
+		// Copy contents to the allocated memory, the header decides how much rom there is
+		if (data_size != this->active_mapper->allocated_rom_size)
+		{
+			std::cout << "ROM is " << data_size << " bytes, the header says " << this->active_mapper->allocated_rom_size << std::endl;
+		}
+
+		memcpy(this->active_mapper->rom, rom, std::min(data_size, this->active_mapper->allocated_rom_size));
 
 		for (int i = 0; i < 0x100; i++)
 		{
@@ -293,6 +502,7 @@ bool Cartridge::LoadCartridgeHeader(uint8_t* rom)
 	case 0x05:
 	case 0x06:
 		header.cartridge_type = CartridgeType::MBC2_TYPE; break;
+	case 0x0F:
 	case 0x10:
 	case 0x11:
 	case 0x12:
@@ -314,6 +524,26 @@ bool Cartridge::LoadCartridgeHeader(uint8_t* rom)
 		header.cartridge_type = CartridgeType::ROM_ONLY; break;
 	}
 
+	switch (rom[0x147])
+	{
+	case 0x03:
+	case 0x06:
+	case 0x09:
+	case 0x0D:
+	case 0x0F:
+	case 0x10:
+	case 0x13:
+	case 0x1B:
+	case 0x1E:
+	case 0x22:
+	case 0xFF:
+		header.has_battery = true; break;
+	default:
+		header.has_battery = false; break;
+	}
+
+	header.has_rtc = rom[0x147] == 0x0F || rom[0x147] == 0x10;
+
 	header.rom_size = (ROMSize)rom[0x148];
 	header.ram_size = (RAMSize)rom[0x149];
 
@@ -357,7 +587,8 @@ uint8_t Cartridge::ReadRAM(uint16_t address)
 {
 	assert(address >= 0xA000 && address <= 0xBFFF);
 
-	if (this->active_mapper->allocated_ram_size == 0)
+	// the mbc3 clock is there without ram too
+	if (this->active_mapper->allocated_ram_size == 0 && this->active_mapper->rtc == nullptr)
 	{
 		return 0xFF;
 	}
@@ -369,10 +600,84 @@ void Cartridge::WriteRAM(uint16_t address, uint8_t value)
 {
 	assert(address >= 0xA000 && address <= 0xBFFF);
 
-	if (this->active_mapper->allocated_ram_size == 0)
+	if (this->active_mapper->allocated_ram_size == 0 && this->active_mapper->rtc == nullptr)
 	{
 		return;
 	}
 
 	this->active_mapper->WriteRAM(address, value);	
-}
\ No newline at end of file
+}
+
+uint16_t Cartridge::GetROMBank()
+{
+	return this->active_mapper->rom_bank_number;
+}
+
+uint16_t Cartridge::GetROMBankCount()
+{
+	return this->active_mapper->rom_bank_count;
+}
+
+const uint8_t* Cartridge::GetROMBankData(uint16_t bank)
+{
+	// bank numbers past the end wrap around like the address lines do
+	uint16_t bank_count = std::max<uint16_t>(this->active_mapper->rom_bank_count, 1);
+	return &this->active_mapper->rom[(bank % bank_count) * 0x4000];
+}
+
+std::string Cartridge::GetSavePath()
+{
+	return this->path.substr(0, this->path.find_last_of('.')) + ".sav";
+}
+
+bool Cartridge::LoadSave()
+{
+	if (this->active_mapper == nullptr || !this->header.has_battery)
+	{
+		return false;
+	}
+
+	std::ifstream file(this->GetSavePath(), std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	size_t size = file.tellg();
+	file.seekg(0);
+
+	size_t ram_size = std::min(size, this->active_mapper->allocated_ram_size);
+	file.read((char*)this->active_mapper->ram, ram_size);
+
+	// the clock is saved after the ram
+	if (this->active_mapper->rtc != nullptr && size > ram_size)
+	{
+		this->active_mapper->rtc->Load(file, size - ram_size);
+	}
+
+	return true;
+}
+
+bool Cartridge::WriteSave()
+{
+	if (this->active_mapper == nullptr || !this->header.has_battery)
+	{
+		return false;
+	}
+
+	std::ofstream file(this->GetSavePath(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not write save: " << this->GetSavePath() << std::endl;
+		return false;
+	}
+
+	file.write((const char*)this->active_mapper->ram, this->active_mapper->allocated_ram_size);
+
+	if (this->active_mapper->rtc != nullptr)
+	{
+		this->active_mapper->rtc->Save(file);
+	}
+
+	return file.good();
+}
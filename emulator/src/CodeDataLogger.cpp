@@ -0,0 +1,191 @@
+#include "CodeDataLogger.h"
+#include "GameBoy.h"
+
+CodeDataLogger::CodeDataLogger(GameBoy* gameboy)
+{
+	this->gb = gameboy;
+}
+
+CodeDataLogger::~CodeDataLogger()
+{
+
+}
+
+void CodeDataLogger::Reset()
+{
+	size_t rom_size = 0;
+	if (this->gb->active_cartridge != nullptr)
+	{
+		rom_size = this->gb->active_cartridge->GetROMBankCount() * 0x4000;
+	}
+
+	this->flags.assign(rom_size, 0);
+	this->instruction_length = 0;
+}
+
+void CodeDataLogger::SetEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	this->instruction_length = 0;
+
+	this->gb->mmu->SetHook(HOOK_CODE_DATA_LOGGER, enabled);
+}
+
+uint32_t CodeDataLogger::GetROMOffset(uint16_t address)
+{
+	if (address <= 0x3FFF)
+	{
+		return address;
+	}
+
+	return this->gb->active_cartridge->GetROMBank() * 0x4000 + (address - 0x4000);
+}
+
+void CodeDataLogger::LogInstruction(uint16_t address)
+{
+	// code running from ram or from the bootrom overlay is not part of the rom
+	if (address > 0x7FFF || (address < 0x100 && this->gb->IsBootromMapped()))
+	{
+		this->instruction_length = 0;
+		return;
+	}
+
+	uint8_t opcode = this->gb->mmu->Peek(address);
+	uint8_t length = (opcode == 0xCB) ? 2 : opcode_lengths[opcode];
+
+	this->instruction_address = address;
+	this->instruction_length = length;
+
+	uint32_t offset = this->GetROMOffset(address);
+	if (offset < this->flags.size())
+	{
+		this->flags[offset] |= CDL_CODE;
+	}
+
+	for (uint8_t i = 1; i < length; i++)
+	{
+		offset = this->GetROMOffset(address + i);
+		if (offset < this->flags.size())
+		{
+			this->flags[offset] |= CDL_OPERAND;
+		}
+	}
+}
+
+void CodeDataLogger::LogRead(uint16_t address)
+{
+	// opcode and operand fetches of the current instruction
+	if ((uint16_t)(address - this->instruction_address) < this->instruction_length)
+	{
+		return;
+	}
+
+	if (address < 0x100 && this->gb->IsBootromMapped())
+	{
+		return;
+	}
+
+	uint32_t offset = this->GetROMOffset(address);
+	if (offset < this->flags.size())
+	{
+		this->flags[offset] |= CDL_DATA;
+	}
+}
+
+uint8_t CodeDataLogger::GetFlags(uint32_t rom_offset)
+{
+	if (rom_offset >= this->flags.size())
+	{
+		return 0;
+	}
+
+	return this->flags[rom_offset];
+}
+
+CDLCoverage CodeDataLogger::GetCoverage()
+{
+	CDLCoverage coverage = { 0 };
+	coverage.rom_size = this->flags.size();
+
+	for (uint8_t f : this->flags)
+	{
+		coverage.code_bytes += (f & CDL_CODE) != 0;
+		coverage.operand_bytes += (f & CDL_OPERAND) != 0;
+		coverage.data_bytes += (f & CDL_DATA) != 0;
+		coverage.touched_bytes += f != 0;
+	}
+
+	return coverage;
+}
+
+static const char cdl_magic[5] = { 'G', 'B', 'C', 'D', 'L' };
+static const uint8_t cdl_version = 1;
+
+bool CodeDataLogger::Export(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not write CDL file: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t size = this->flags.size();
+	uint8_t header[10] = {
+		(uint8_t)cdl_magic[0], (uint8_t)cdl_magic[1], (uint8_t)cdl_magic[2], (uint8_t)cdl_magic[3], (uint8_t)cdl_magic[4],
+		cdl_version,
+		(uint8_t)(size & 0xFF), (uint8_t)((size >> 8) & 0xFF), (uint8_t)((size >> 16) & 0xFF), (uint8_t)(size >> 24)
+	};
+
+	std::vector<uint8_t> packed((size + 1) / 2, 0);
+	for (uint32_t i = 0; i < size; i++)
+	{
+		packed[i / 2] |= (this->flags[i] & 0x0F) << (4 * (i % 2));
+	}
+
+	file.write((const char*)header, sizeof(header));
+	file.write((const char*)packed.data(), packed.size());
+	return file.good();
+}
+
+bool CodeDataLogger::Import(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open CDL file: " << path << std::endl;
+		return false;
+	}
+
+	uint8_t header[10];
+	file.read((char*)header, sizeof(header));
+
+	if (!file.good() || memcmp(header, cdl_magic, sizeof(cdl_magic)) != 0 || header[5] != cdl_version)
+	{
+		std::cerr << "Invalid CDL file: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t size = header[6] | (header[7] << 8) | (header[8] << 16) | ((uint32_t)header[9] << 24);
+	if (size != this->flags.size())
+	{
+		std::cerr << "CDL file was recorded for a different ROM size" << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> packed((size + 1) / 2, 0);
+	file.read((char*)packed.data(), packed.size());
+
+	if (!file.good())
+	{
+		std::cerr << "CDL file is truncated: " << path << std::endl;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < size; i++)
+	{
+		this->flags[i] |= (packed[i / 2] >> (4 * (i % 2))) & 0x0F;
+	}
+
+	return true;
+}
\ No newline at end of file
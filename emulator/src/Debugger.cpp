@@ -0,0 +1,214 @@
+#include "Debugger.h"
+#include "GameBoy.h"
+
+Debugger::Debugger(GameBoy* gameboy)
+{
+	this->gb = gameboy;
+
+	this->Reset();
+}
+
+Debugger::~Debugger()
+{
+
+}
+
+void Debugger::Reset()
+{
+	this->break_requested = false;
+	this->resume_pc = -1;
+
+	this->RebuildMaps();
+}
+
+void Debugger::AddBreakpoint(uint16_t address, int32_t bank, const BreakpointCondition& condition)
+{
+	if (address < 0x4000 || address > 0x7FFF)
+	{
+		bank = BREAKPOINT_ANY_BANK;
+	}
+
+	this->breakpoints.push_back({ address, bank, condition, 0 });
+	this->RebuildMaps();
+}
+
+void Debugger::RemoveBreakpoint(uint32_t index)
+{
+	if (index >= this->breakpoints.size())
+	{
+		return;
+	}
+
+	this->breakpoints.erase(this->breakpoints.begin() + index);
+	this->RebuildMaps();
+}
+
+void Debugger::AddWatchpoint(uint16_t address, uint8_t type)
+{
+	this->watchpoints.push_back({ address, type });
+	this->RebuildMaps();
+}
+
+void Debugger::RemoveWatchpoint(uint32_t index)
+{
+	if (index >= this->watchpoints.size())
+	{
+		return;
+	}
+
+	this->watchpoints.erase(this->watchpoints.begin() + index);
+	this->RebuildMaps();
+}
+
+void Debugger::RebuildMaps()
+{
+	memset(this->exec_bitmap, 0, sizeof(this->exec_bitmap));
+	memset(this->watch_pages, 0, sizeof(this->watch_pages));
+
+	uint32_t bank_count = 0;
+	if (this->gb->active_cartridge != nullptr)
+	{
+		bank_count = this->gb->active_cartridge->GetROMBankCount();
+	}
+
+	this->banked_exec_bitmap.assign(bank_count * (0x4000 / 64), 0);
+
+	for (Breakpoint& bp : this->breakpoints)
+	{
+		if (bp.bank == BREAKPOINT_ANY_BANK)
+		{
+			this->exec_bitmap[bp.address / 64] |= (1ull << (bp.address % 64));
+		}
+		else if ((uint32_t)bp.bank < bank_count)
+		{
+			uint32_t bit = bp.bank * 0x4000 + (bp.address - 0x4000);
+			this->banked_exec_bitmap[bit / 64] |= (1ull << (bit % 64));
+		}
+	}
+
+	for (Watchpoint& wp : this->watchpoints)
+	{
+		this->watch_pages[wp.address >> 8] |= wp.type;
+	}
+
+	this->gb->mmu->SetHook(HOOK_WATCHPOINTS, !this->watchpoints.empty());
+	this->armed = !this->breakpoints.empty() || !this->watchpoints.empty();
+}
+
+void Debugger::BeginRun()
+{
+	this->break_requested = false;
+	this->running = true;
+
+	// the cpu was stepped somewhere else since the last stop
+	if (this->resume_pc != this->gb->cpu->registers.PC)
+	{
+		this->resume_pc = -1;
+	}
+}
+
+void Debugger::EndRun()
+{
+	this->running = false;
+}
+
+bool Debugger::TestExecutionBit(uint16_t pc)
+{
+	if (this->exec_bitmap[pc / 64] & (1ull << (pc % 64)))
+	{
+		return true;
+	}
+
+	if (pc >= 0x4000 && pc <= 0x7FFF && !this->banked_exec_bitmap.empty())
+	{
+		uint32_t bit = this->gb->active_cartridge->GetROMBank() * 0x4000 + (pc - 0x4000);
+		if (bit / 64 < this->banked_exec_bitmap.size())
+		{
+			return this->banked_exec_bitmap[bit / 64] & (1ull << (bit % 64));
+		}
+	}
+
+	return false;
+}
+
+bool Debugger::EvaluateBreakpoints(uint16_t pc)
+{
+	int32_t bank = BREAKPOINT_ANY_BANK;
+	if (pc >= 0x4000 && pc <= 0x7FFF)
+	{
+		bank = this->gb->active_cartridge->GetROMBank();
+	}
+
+	bool hit = false;
+	for (Breakpoint& bp : this->breakpoints)
+	{
+		if (bp.address != pc || (bp.bank != BREAKPOINT_ANY_BANK && bp.bank != bank))
+		{
+			continue;
+		}
+
+		bp.hit_count++;
+
+		if (bp.condition.Evaluate(this->gb, bp.hit_count))
+		{
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+bool Debugger::CheckExecution(uint16_t pc)
+{
+	if (!this->TestExecutionBit(pc))
+	{
+		return false;
+	}
+
+	if (this->resume_pc == pc)
+	{
+		// we are resuming from this breakpoint, let the instruction run
+		this->resume_pc = -1;
+		return false;
+	}
+
+	if (!this->EvaluateBreakpoints(pc))
+	{
+		return false;
+	}
+
+	this->resume_pc = pc;
+	this->last_hit_address = pc;
+	this->last_hit_was_watchpoint = false;
+	this->break_requested = true;
+	return true;
+}
+
+void Debugger::CheckWatchpoints(uint16_t address, uint8_t type)
+{
+	if (!this->running || (this->watch_pages[address >> 8] & type) == 0)
+	{
+		return;
+	}
+
+	for (Watchpoint& wp : this->watchpoints)
+	{
+		if (wp.address == address && (wp.type & type))
+		{
+			this->last_hit_address = address;
+			this->last_hit_was_watchpoint = true;
+			this->break_requested = true;
+			return;
+		}
+	}
+}
+
+void Debugger::OnRead(uint16_t address)
+{
+	this->CheckWatchpoints(address, WATCH_READ);
+}
+
+void Debugger::OnWrite(uint16_t address)
+{
+	this->CheckWatchpoints(address, WATCH_WRITE);
+}
\ No newline at end of file
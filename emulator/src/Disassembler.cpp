@@ -0,0 +1,279 @@
+#include "Disassembler.h"
+#include "GameBoy.h"
+
+#include <algorithm>
+
+static const uint32_t region_bounds[REGION_COUNT + 1] = {
+	0x0000, 0x4000, 0x8000, 0xA000, 0xC000, 0xE000, 0x10000
+};
+
+Disassembler::Disassembler(GameBoy* gameboy)
+{
+	this->gb = gameboy;
+
+	memset(this->region_start_rows, 0, sizeof(this->region_start_rows));
+	this->Invalidate();
+}
+
+Disassembler::~Disassembler()
+{
+
+}
+
+void Disassembler::Invalidate()
+{
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		this->regions[i].dirty = true;
+	}
+
+	this->banked_regions.clear();
+}
+
+Disassembler::RegionCache& Disassembler::GetRegion(DisassemblyRegion region)
+{
+	if (region == REGION_ROMX)
+	{
+		return this->banked_regions[this->current_bank];
+	}
+
+	return this->regions[region];
+}
+
+void Disassembler::Update()
+{
+	if (this->gb->active_cartridge != nullptr)
+	{
+		this->current_bank = this->gb->active_cartridge->GetROMBank();
+	}
+
+	// the bootrom overlays the first 256 bytes of ROM0
+	if (this->bootrom_mapped != this->gb->IsBootromMapped())
+	{
+		this->bootrom_mapped = this->gb->IsBootromMapped();
+		this->regions[REGION_ROM0].dirty = true;
+	}
+
+	this->region_start_rows[0] = 0;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		RegionCache& cache = this->GetRegion((DisassemblyRegion)i);
+		if (cache.dirty)
+		{
+			this->DecodeRegion((DisassemblyRegion)i, cache);
+		}
+
+		this->region_start_rows[i + 1] = this->region_start_rows[i] + cache.rows.size();
+	}
+}
+
+bool Disassembler::IsLoggedData(uint16_t address)
+{
+	if (address > 0x7FFF || this->gb->active_cartridge == nullptr)
+	{
+		return false;
+	}
+
+	if (address < 0x100 && this->bootrom_mapped)
+	{
+		return false;
+	}
+
+	uint8_t flags = this->gb->cdl->GetFlags(this->gb->cdl->GetROMOffset(address));
+	return (flags & CDL_DATA) && (flags & (CDL_CODE | CDL_OPERAND)) == 0;
+}
+
+void Disassembler::DecodeRegion(DisassemblyRegion region, RegionCache& cache)
+{
+	uint32_t start = region_bounds[region];
+	uint32_t end = region_bounds[region + 1];
+
+	cache.rows.clear();
+	cache.dirty = false;
+
+	std::vector<uint8_t> bytes(end - start);
+	this->gb->mmu->ReadBlock(start, bytes.data(), end - start);
+
+	uint32_t address = start;
+	while (address < end)
+	{
+		DisassemblyRow row = { 0 };
+		row.address = address;
+
+		uint8_t op = bytes[address - start];
+		uint8_t length = (op == 0xCB) ? 2 : opcode_lengths[op];
+
+		// instructions running past the end of the region are shown as data
+		if (address + length > end || this->IsLoggedData(address))
+		{
+			length = 1;
+			row.data = true;
+		}
+
+		row.length = length;
+		for (uint8_t i = 0; i < length; i++)
+		{
+			row.bytes[i] = bytes[address - start + i];
+		}
+
+		cache.rows.push_back(row);
+		address += length;
+	}
+}
+
+void Disassembler::Validate(size_t first, size_t last)
+{
+	last = std::min(last, this->GetRowCount());
+
+	for (size_t i = first; i < last; i++)
+	{
+		const DisassemblyRow& row = this->GetRow(i);
+
+		uint8_t bytes[sizeof(row.bytes)];
+		this->gb->mmu->ReadBlock(row.address, bytes, row.length);
+
+		if (memcmp(bytes, row.bytes, row.length) != 0)
+		{
+			// find the region this row belongs to and decode it again on the next update
+			for (int r = 0; r < REGION_COUNT; r++)
+			{
+				if (row.address >= region_bounds[r] && row.address < region_bounds[r + 1])
+				{
+					this->GetRegion((DisassemblyRegion)r).dirty = true;
+				}
+			}
+		}
+	}
+}
+
+size_t Disassembler::GetRowCount()
+{
+	return this->region_start_rows[REGION_COUNT];
+}
+
+const DisassemblyRow& Disassembler::GetRow(size_t index)
+{
+	int region = 0;
+	while (region < REGION_COUNT - 1 && index >= this->region_start_rows[region + 1])
+	{
+		region++;
+	}
+
+	return this->GetRegion((DisassemblyRegion)region).rows[index - this->region_start_rows[region]];
+}
+
+size_t Disassembler::FindRow(uint16_t address)
+{
+	int region = 0;
+	while (region < REGION_COUNT - 1 && address >= region_bounds[region + 1])
+	{
+		region++;
+	}
+
+	std::vector<DisassemblyRow>& rows = this->GetRegion((DisassemblyRegion)region).rows;
+
+	// last row that starts at or before the address
+	auto it = std::upper_bound(rows.begin(), rows.end(), address,
+		[](uint16_t value, const DisassemblyRow& row) { return value < row.address; });
+
+	size_t local = (it == rows.begin()) ? 0 : (it - rows.begin()) - 1;
+	return this->region_start_rows[region] + local;
+}
+
+void Disassembler::FormatAddress(const DisassemblyRow& row, char* buffer, size_t size)
+{
+	if (row.address <= 0x3FFF)
+	{
+		snprintf(buffer, size, "00:%04X", row.address);
+	}
+	else if (row.address <= 0x7FFF)
+	{
+		snprintf(buffer, size, "%02X:%04X", this->current_bank, row.address);
+	}
+	else
+	{
+		snprintf(buffer, size, "%04X", row.address);
+	}
+}
+
+// Replaces the first standalone "n" or "nn" in name with the operand text
+static void ReplaceOperand(const std::string& name, const char* token, const char* operand, char* buffer, size_t size)
+{
+	size_t token_length = strlen(token);
+	size_t pos = 0;
+
+	while ((pos = name.find(token, pos)) != std::string::npos)
+	{
+		bool start_ok = pos == 0 || !isalnum((unsigned char)name[pos - 1]);
+		bool end_ok = pos + token_length >= name.size() || !isalnum((unsigned char)name[pos + token_length]);
+
+		if (start_ok && end_ok)
+		{
+			snprintf(buffer, size, "%s%s%s", name.substr(0, pos).c_str(), operand, name.c_str() + pos + token_length);
+			return;
+		}
+
+		pos += token_length;
+	}
+
+	snprintf(buffer, size, "%s", name.c_str());
+}
+
+void Disassembler::FormatInstruction(const DisassemblyRow& row, char* buffer, size_t size)
+{
+	if (row.data)
+	{
+		snprintf(buffer, size, "db $%02X", row.bytes[0]);
+		return;
+	}
+
+	uint8_t op = row.bytes[0];
+	uint8_t n = row.bytes[1];
+	uint16_t nn = row.bytes[1] | (row.bytes[2] << 8);
+
+	char operand[16];
+
+	switch (op)
+	{
+	case 0xCB:
+		snprintf(buffer, size, "%s", opcode_cb_names[n].c_str());
+		return;
+	case 0x18: // JR e8
+	case 0x20: // JR NZ, e8
+	case 0x28: // JR Z, e8
+	case 0x30: // JR NC, e8
+	case 0x38: // JR C, e8
+		snprintf(operand, sizeof(operand), "$%04X", (uint16_t)(row.address + 2 + (int8_t)n));
+		ReplaceOperand(opcode_names[op], "n", operand, buffer, size);
+		return;
+	case 0xE0: // LDH [a8], A
+		snprintf(buffer, size, "LDH ($FF%02X),A", n);
+		return;
+	case 0xF0: // LDH A, [a8]
+		snprintf(buffer, size, "LDH A,($FF%02X)", n);
+		return;
+	case 0xE8: // ADD SP, e8
+		snprintf(buffer, size, "ADD SP,%d", (int8_t)n);
+		return;
+	case 0xF8: // LD HL, SP + e8
+		snprintf(buffer, size, "LD HL,SP%+d", (int8_t)n);
+		return;
+	default:
+		break;
+	}
+
+	if (row.length == 3)
+	{
+		snprintf(operand, sizeof(operand), "$%04X", nn);
+		ReplaceOperand(opcode_names[op], "nn", operand, buffer, size);
+	}
+	else if (row.length == 2)
+	{
+		snprintf(operand, sizeof(operand), "$%02X", n);
+		ReplaceOperand(opcode_names[op], "n", operand, buffer, size);
+	}
+	else
+	{
+		snprintf(buffer, size, "%s", opcode_names[op].c_str());
+	}
+}
\ No newline at end of file
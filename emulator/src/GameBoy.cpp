@@ -7,15 +7,22 @@ GameBoy::GameBoy()
 	this->ppu = new PPU(this);
 	this->timer = new Timer(this);
 	this->active_cartridge = nullptr;
+	this->debugger = new Debugger(this);
+	this->cdl = new CodeDataLogger(this);
+	this->profiler = new Profiler(this);
 }
 
 GameBoy::~GameBoy()
 {
 	if(this->active_cartridge)
 	{
+		this->active_cartridge->WriteSave();
 		delete this->active_cartridge;
 	}
 
+	delete this->profiler;
+	delete this->cdl;
+	delete this->debugger;
 	delete this->timer;
 	delete this->ppu;
 	delete this->cpu;
@@ -38,11 +45,73 @@ void GameBoy::Update(float dt)
 		// tick components
 		this->cpu->Tick();
 
+		this->cycle_count++;
+		this->mmu->Tick();
 		this->timer->Update(1);
 		this->ppu->Tick(1);
 	}
 }
 
+bool GameBoy::Run(uint32_t cycles)
+{
+	if (this->debugger->IsArmed())
+	{
+		return this->RunChecked(cycles);
+	}
+
+	for (uint32_t i = 0; i < cycles; i++)
+	{
+		this->Update(0.0f);
+	}
+
+	return false;
+}
+
+bool GameBoy::RunChecked(uint32_t cycles)
+{
+	this->debugger->BeginRun();
+
+	bool stopped = false;
+	for (uint32_t i = 0; i < cycles; i++)
+	{
+		// the cpu fetches a new instruction on the next tick
+		if (this->cpu->internal_clock == 0 && !this->cpu->halted && this->debugger->CheckExecution(this->cpu->registers.PC))
+		{
+			stopped = true;
+			break;
+		}
+
+		this->Update(0.0f);
+
+		if (this->debugger->break_requested)
+		{
+			stopped = true;
+			break;
+		}
+	}
+
+	this->debugger->EndRun();
+	return stopped;
+}
+
+void GameBoy::SetRTCClock(RTCClock clock)
+{
+	this->rtc_clock = clock;
+
+	if (this->active_cartridge != nullptr && this->active_cartridge->GetRTC() != nullptr)
+	{
+		this->active_cartridge->GetRTC()->SetClock(clock, &this->cycle_count);
+	}
+}
+
+void GameBoy::OnFrameComplete()
+{
+	if (this->frame_callback)
+	{
+		this->frame_callback(this->ppu->GetFrontBuffer(), this->ppu->GetFrameCount());
+	}
+}
+
 uint8_t GameBoy::UpdateInput(uint8_t joyp)
 {
 	if (GET_BIT(joyp, 5) == 1 && GET_BIT(joyp, 4) == 1)
@@ -102,17 +171,38 @@ bool GameBoy::LoadROM(std::string rom_path)
 		
 		if(this->active_cartridge)
 		{
+			this->active_cartridge->WriteSave();
 			delete this->active_cartridge;
 		}
 		
-		this->mmu->Reset();
-
 		this->active_cartridge = new Cartridge();
 		this->active_cartridge->LoadROM(rom_path, buffer.data(), buffer.size());
 
+		// the clock needs its source before the save sets its time
+		if (this->active_cartridge->GetRTC() != nullptr)
+		{
+			this->active_cartridge->GetRTC()->SetClock(this->rtc_clock, &this->cycle_count);
+		}
+
+		this->active_cartridge->LoadSave();
+
+		// maps its pages for the new cartridge
+		this->mmu->Reset();
+
 		this->cpu->Reset();
 		this->ppu->Reset();
 		this->timer->Reset();
+		this->debugger->Reset();
+		this->cdl->Reset();
+		this->profiler->Reset();
+
+		// rgblink writes game.sym next to game.gb
+		this->profiler->ClearSymbols();
+		std::string sym_path = rom_path.substr(0, rom_path.find_last_of('.')) + ".sym";
+		if (std::ifstream(sym_path).good())
+		{
+			this->profiler->LoadSymbols(sym_path);
+		}
 
 		this->on_bootrom = true;
 
@@ -1,6 +1,8 @@
 #include "MemoryBus.h"
 #include "GameBoy.h"
 
+#include <algorithm>
+
 static uint8_t memory[0x10000]; // Soon this will be removed
 
 MemoryBus::MemoryBus(GameBoy* gb)
@@ -19,10 +21,226 @@ void MemoryBus::Reset()
 	memset(memory, 0, 0x10000);
 
 	memory[0xFF00] = 0xFF;
+
+	memset(this->locked_page, 0xFF, sizeof(this->locked_page));
+
+	this->vram_locked = false;
+	this->oam_locked = false;
+	this->dma_cycles = 0;
+	this->MapPages();
+}
+
+void MemoryBus::MapPages()
+{
+	for (uint32_t page = 0; page < MEMORY_PAGE_COUNT; page++)
+	{
+		this->mapped_pages[page] = nullptr;
+	}
+
+	// nothing is mapped without a cartridge
+	if (this->gb->active_cartridge != nullptr)
+	{
+		// work ram and its echo
+		for (uint32_t page = 0xC000 >> MEMORY_PAGE_SHIFT; page <= 0xFDFF >> MEMORY_PAGE_SHIFT; page++)
+		{
+			this->mapped_pages[page] = &memory[page << MEMORY_PAGE_SHIFT];
+		}
+
+		const uint8_t* vram = this->gb->ppu->GetVRAMData();
+		for (uint32_t page = 0x8000 >> MEMORY_PAGE_SHIFT; page <= 0x9FFF >> MEMORY_PAGE_SHIFT; page++)
+		{
+			this->mapped_pages[page] = &vram[(page << MEMORY_PAGE_SHIFT) - 0x8000];
+		}
+	}
+
+	this->rom0_bank = nullptr;
+	this->romx_bank = nullptr;
+	this->ram_bank = nullptr;
+	this->MapCartridgePages();
+
+	this->UpdatePages();
+}
+
+void MemoryBus::MapCartridgePages()
+{
+	if (this->gb->active_cartridge == nullptr)
+	{
+		return;
+	}
+
+	const uint8_t* rom0_bank = this->gb->active_cartridge->GetROM0Bank();
+	const uint8_t* romx_bank = this->gb->active_cartridge->GetROMXBank();
+	uint8_t* ram_bank = this->gb->active_cartridge->GetRAMBank();
+
+	// most writes to the mapper don't switch banks
+	if (rom0_bank == this->rom0_bank && romx_bank == this->romx_bank && ram_bank == this->ram_bank)
+	{
+		return;
+	}
+
+	this->rom0_bank = rom0_bank;
+	this->romx_bank = romx_bank;
+	this->ram_bank = ram_bank;
+
+	for (uint32_t page = 0; page < 0x4000 >> MEMORY_PAGE_SHIFT; page++)
+	{
+		uint32_t offset = page << MEMORY_PAGE_SHIFT;
+		this->mapped_pages[page] = (rom0_bank != nullptr) ? &rom0_bank[offset] : nullptr;
+		this->mapped_pages[page + (0x4000 >> MEMORY_PAGE_SHIFT)] = (romx_bank != nullptr) ? &romx_bank[offset] : nullptr;
+	}
+
+	for (uint32_t page = 0xA000 >> MEMORY_PAGE_SHIFT; page <= 0xBFFF >> MEMORY_PAGE_SHIFT; page++)
+	{
+		this->mapped_pages[page] = (ram_bank != nullptr) ? &ram_bank[(page << MEMORY_PAGE_SHIFT) - 0xA000] : nullptr;
+	}
+
+	// the dma restriction stays until the transfer ends
+	if (this->dma_cycles == 0)
+	{
+		this->UpdateCartridgePages();
+	}
+}
+
+void MemoryBus::UpdateCartridgePages()
+{
+	for (uint32_t page = 0; page < 0x8000 >> MEMORY_PAGE_SHIFT; page++)
+	{
+		this->read_pages[page] = this->mapped_pages[page];
+	}
+
+	for (uint32_t page = 0xA000 >> MEMORY_PAGE_SHIFT; page <= 0xBFFF >> MEMORY_PAGE_SHIFT; page++)
+	{
+		this->read_pages[page] = this->mapped_pages[page];
+		this->write_pages[page] = (this->ram_bank != nullptr) ? &this->ram_bank[(page << MEMORY_PAGE_SHIFT) - 0xA000] : nullptr;
+	}
+}
+
+void MemoryBus::UpdatePages()
+{
+	for (uint32_t page = 0; page < MEMORY_PAGE_COUNT; page++)
+	{
+		this->read_pages[page] = nullptr;
+		this->write_pages[page] = nullptr;
+	}
+
+	if (this->gb->active_cartridge == nullptr)
+	{
+		return;
+	}
+
+	// the cpu can only reach hram and the io registers during oam dma
+	if (this->dma_cycles != 0)
+	{
+		for (uint32_t page = 0; page < 0xFF00 >> MEMORY_PAGE_SHIFT; page++)
+		{
+			this->read_pages[page] = this->locked_page;
+			this->write_pages[page] = this->discard_page;
+		}
+
+		return;
+	}
+
+	for (uint32_t page = 0; page < MEMORY_PAGE_COUNT; page++)
+	{
+		this->read_pages[page] = this->mapped_pages[page];
+	}
+
+	// work ram and its echo are written in place too
+	for (uint32_t page = 0xC000 >> MEMORY_PAGE_SHIFT; page <= 0xFDFF >> MEMORY_PAGE_SHIFT; page++)
+	{
+		this->write_pages[page] = &memory[page << MEMORY_PAGE_SHIFT];
+	}
+
+	this->UpdateCartridgePages();
+
+	this->UpdateVideoMemoryPages();
+}
+
+void MemoryBus::SetVideoMemoryLocks(bool vram_locked, bool oam_locked)
+{
+	this->vram_locked = vram_locked;
+	this->oam_locked = oam_locked;
+
+	// the dma restriction covers both, the locks are applied when it ends
+	if (this->gb->active_cartridge == nullptr || this->dma_cycles != 0)
+	{
+		return;
+	}
+
+	this->UpdateVideoMemoryPages();
+}
+
+void MemoryBus::UpdateVideoMemoryPages()
+{
+	// vram is read in place, writes go through the ppu to keep its tile cache up to date
+	for (uint32_t page = 0x8000 >> MEMORY_PAGE_SHIFT; page <= 0x9FFF >> MEMORY_PAGE_SHIFT; page++)
+	{
+		this->read_pages[page] = this->vram_locked ? this->locked_page : this->mapped_pages[page];
+		this->write_pages[page] = this->vram_locked ? this->discard_page : nullptr;
+	}
+
+	// the unused area after oam reads 0xFF while oam is locked, like on hardware
+	this->read_pages[0xFE00 >> MEMORY_PAGE_SHIFT] = this->oam_locked ? this->locked_page : nullptr;
+	this->write_pages[0xFE00 >> MEMORY_PAGE_SHIFT] = this->oam_locked ? this->discard_page : nullptr;
+}
+
+void MemoryBus::StartDMA(uint8_t source_page)
+{
+	memory[0xFF46] = source_page;
+
+	// sources past work ram read its echo
+	uint16_t source = ((source_page >= 0xE0) ? source_page - 0x20 : source_page) << MEMORY_PAGE_SHIFT;
+
+	// the cpu can't reach the source or oam until the transfer ends, so copying everything
+	// now looks the same to it as one byte per M-cycle
+	uint8_t block[0xA0];
+	this->ReadBlock(source, block, sizeof(block));
+
+	this->gb->ppu->WriteOAMBlock(block);
+
+	this->dma_cycles = 160;
+	this->UpdatePages();
+}
+
+void MemoryBus::SetHook(uint8_t hook, bool enabled)
+{
+	if (enabled)
+	{
+		this->hooks |= hook;
+	}
+	else
+	{
+		this->hooks &= ~hook;
+	}
+}
+
+void MemoryBus::RunReadHooks(uint32_t address)
+{
+	if (this->hooks & HOOK_WATCHPOINTS)
+	{
+		this->gb->debugger->OnRead(address);
+	}
+
+	if ((this->hooks & HOOK_CODE_DATA_LOGGER) && address <= 0x7FFF)
+	{
+		this->gb->cdl->LogRead(address);
+	}
 }
 
 void MemoryBus::Write(uint32_t address, uint8_t data)
 {
+	if (this->hooks & HOOK_WATCHPOINTS)
+	{
+		this->gb->debugger->OnWrite(address);
+	}
+
+	uint8_t* page = this->write_pages[(address >> MEMORY_PAGE_SHIFT) & (MEMORY_PAGE_COUNT - 1)];
+	if (page != nullptr)
+	{
+		page[address & (MEMORY_PAGE_SIZE - 1)] = data;
+		return;
+	}
+
 	if(address == 0xFF02 && data == 0x81)
 	{
 		std::cout << this->Read(0xFF01);
@@ -36,13 +254,10 @@ void MemoryBus::Write(uint32_t address, uint8_t data)
 
 	if (address == 0xFF46)
 	{
-		// TODO: Cycles for DMA transfer
-		for (uint8_t i = 0; i <= 0x9F; i++)
+		if (gb->active_cartridge != nullptr)
 		{
-			this->gb->ppu->WriteOAM(0xFE00 + i, this->Read((data * 0x100) + i));
+			this->StartDMA(data);
 		}
-
-		memory[0xFF46] = data;
 		return;
 	}
 	
@@ -60,7 +275,9 @@ void MemoryBus::Write(uint32_t address, uint8_t data)
 		}
 		else if(address <= 0x7FFF)
 		{
+			// the mapper is only called for its control registers, reads go through the banks it publishes
 			gb->active_cartridge->WriteROM(address, data);
+			this->MapCartridgePages();
 			return;
 		}
 		else if(address >= 0xA000 && address <= 0xBFFF)
@@ -78,6 +295,12 @@ void MemoryBus::Write(uint32_t address, uint8_t data)
 			gb->ppu->WriteOAM(address, data);
 			return;
 		}
+		else if (address >= 0xFF40 && address <= 0xFF4B)
+		{
+			// 0xFF46 was handled above
+			gb->ppu->WriteRegister(address, data);
+			return;
+		}
 	}
 	else
 	{
@@ -88,6 +311,22 @@ void MemoryBus::Write(uint32_t address, uint8_t data)
 }
 
 uint8_t MemoryBus::Read(uint32_t address)
+{
+	if (this->hooks)
+	{
+		this->RunReadHooks(address);
+	}
+
+	const uint8_t* page = this->read_pages[(address >> MEMORY_PAGE_SHIFT) & (MEMORY_PAGE_COUNT - 1)];
+	if (page != nullptr)
+	{
+		return page[address & (MEMORY_PAGE_SIZE - 1)];
+	}
+
+	return this->Peek(address);
+}
+
+uint8_t MemoryBus::Peek(uint32_t address)
 {
 	if(gb->active_cartridge != nullptr)
 	{
@@ -111,10 +350,68 @@ uint8_t MemoryBus::Read(uint32_t address)
 		{
 			return this->gb->timer->div;
 		}
+		else if (address >= 0xFF40 && address <= 0xFF4B && address != 0xFF46)
+		{
+			return gb->ppu->ReadRegister(address);
+		}
 	}
 	else
 	{
 		return 0;
 	}
 	return memory[address];
-}
\ No newline at end of file
+}
+void MemoryBus::ReadBlock(uint32_t address, uint8_t* dst, uint32_t length)
+{
+	while (length > 0)
+	{
+		address &= 0xFFFF;
+
+		uint32_t offset = address & (MEMORY_PAGE_SIZE - 1);
+		uint32_t count = std::min(length, MEMORY_PAGE_SIZE - offset);
+
+		const uint8_t* page = this->mapped_pages[address >> MEMORY_PAGE_SHIFT];
+		if (page != nullptr)
+		{
+			memcpy(dst, &page[offset], count);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				dst[i] = this->Peek(address + i);
+			}
+		}
+
+		address += count;
+		dst += count;
+		length -= count;
+	}
+}
+
+MemorySpan MemoryBus::GetSpan(MemoryRegion region)
+{
+	switch (region)
+	{
+	case MEMORY_REGION_ROM0:
+		if (this->gb->active_cartridge == nullptr)
+		{
+			return { nullptr, 0, 0x0000 };
+		}
+		return { this->gb->active_cartridge->GetROMBankData(0), 0x4000, 0x0000 };
+	case MEMORY_REGION_ROMX:
+		if (this->gb->active_cartridge == nullptr)
+		{
+			return { nullptr, 0, 0x4000 };
+		}
+		return { this->gb->active_cartridge->GetROMBankData(this->gb->active_cartridge->GetROMBank()), 0x4000, 0x4000 };
+	case MEMORY_REGION_VRAM:
+		return { this->gb->ppu->GetVRAMData(), 0x2000, 0x8000 };
+	case MEMORY_REGION_WRAM:
+		return { &memory[0xC000], 0x2000, 0xC000 };
+	case MEMORY_REGION_OAM:
+		return { this->gb->ppu->GetOAMData(), 0xA0, 0xFE00 };
+	default:
+		return { nullptr, 0, 0 };
+	}
+}
@@ -1,70 +1,69 @@
 #include "PPU.h"
 #include "GameBoy.h"
+#include "RenderThread.h"
+
+#include <algorithm>
+#include <cstring>
 
 PPU::PPU(GameBoy* gameboy)
 {
     this->gb = gameboy;
+    this->kernels = &GetPixelKernels();
 
     this->Reset();
 }
 
 PPU::~PPU()
 {
-
+    delete this->render_thread;
 }
 
 void PPU::Reset()
 {
-    this->SwitchMode(2);
     this->fetcher_type = BACKGROUND;
-    
-    for (int i = 0; i <= 0x1FFF; i++)
-    {
-        this->vram[i] = 0;
-    }
 
-    for (int i = 0; i <= 0x9F; i++)
+    if (this->render_thread != nullptr)
     {
-        this->oam[i] = 0;
+        this->render_thread->WaitIdle();
     }
-}
 
-void PPU::Tick(uint8_t cycles)
-{
-    uint8_t lcd_control = this->gb->mmu->Read(0xFF40);
-    if((lcd_control & 0x80) == 0)
+    this->video_memory.Reset();
+
+    if (this->render_thread != nullptr)
     {
-        //return; // disabled
+        this->render_thread->SyncVideoMemory(this->video_memory);
     }
 
-    uint8_t ly = this->gb->mmu->Read(0xFF44);
-    uint8_t lcy = this->gb->mmu->Read(0xFF45);
-    uint8_t lcd_status = this->gb->mmu->Read(0xFF41);
+    memset(this->framebuffers, 0, sizeof(this->framebuffers));
+    this->screen_pixels = this->framebuffers[this->GetFrameCount() & 1];
 
-    //this->gb->mmu->Write(0xFF42, (uint8_t)(glfwGetTime() * 8));
-    
-    if (ly == lcy)
+    for (int i = 0; i <= 0x9F; i++)
     {
-        this->gb->cpu->SetInterruptFlag(1, true);
-        
-        SET_BIT(lcd_status, 6);
-        SET_BIT(lcd_status, 2);
+        this->oam[i] = 0;
     }
-    else
+
+    this->line_objects_dirty = true;
+
+    // the bootrom turns the lcd on
+    for (uint16_t address = 0xFF40; address <= 0xFF4B; address++)
     {
-        CLEAR_BIT(lcd_status, 6);
-        CLEAR_BIT(lcd_status, 2);
+        this->WriteRegister(address, 0);
     }
 
-    if (lcd_status & 0x1C)
+    this->stat = 0;
+    this->stat_line = false;
+    this->TurnOffLCD();
+}
+
+void PPU::Tick(uint8_t cycles)
+{
+    uint8_t lcd_control = this->lcdc;
+    if((lcd_control & 0x80) == 0)
     {
-        this->gb->cpu->SetInterruptFlag(1, true);
+        return; // disabled
     }
 
-    lcd_status &= (~0x03);
-    lcd_status |= this->mode;
-
-    this->gb->mmu->Write(0xFF41, lcd_status);
+    uint8_t ly = this->ly;
 
     this->internal_clock += cycles * 4;
 
@@ -90,56 +89,52 @@ void PPU::Tick(uint8_t cycles)
     {
         this->SwitchMode(3);
     }
+    else if(this->mode == 3 && this->line_render_mode == PPU_RENDER_SCANLINE)
+    {
+        // the whole drawing time was spent as a single pause
+        if (this->skip_frame)
+        {
+            // only the window state carries over to the next lines
+            if (this->line_job.segments[0].registers.wy == this->ly)
+            {
+                this->reached_window_in_frame = true;
+            }
+        }
+        else
+        {
+            this->RenderScanline();
+        }
+
+        this->SwitchMode(0);
+    }
     else if(this->mode == 3)
     {
-        uint8_t scy = this->gb->mmu->Read(0xFF42);
-        uint8_t scx = this->gb->mmu->Read(0xFF43);
+        uint8_t scy = this->scy;
+        uint8_t scx = this->scx;
 
         if(this->fetcher_stage == 0 && this->internal_clock >= 2) // takes 2 T-Cycles to process
         {
             uint16_t map_location = 0;
             if (this->fetcher_type == SPRITE)
             {
-                for (int i = 0; i < this->object_count; i++)
-                {
-                    if (this->object_buffer[i].x_pos <= this->current_line_x + 8)
-                    {
-                        this->fetcher_type = SPRITE;
-
-                        if (GET_BIT(lcd_control, 2))
-                        {
-                            this->sprite_fetcher.tile_id = this->object_buffer[i].tile;
-                            if (ly + 16 >= this->object_buffer[i].y_pos + 8)
-                            {
-                                SET_BIT(this->sprite_fetcher.tile_id, 0);
-                            }
-                        }
-                        else
-                        {
-                            this->sprite_fetcher.tile_id = this->object_buffer[i].tile;
-                        }
+                // the fifo only switches to the fetcher once the object under the cursor is reached
+                const Sprite& sp = this->object_buffer[this->object_cursor];
+                this->object_cursor++;
 
-                        this->current_rendering_sprite = this->object_buffer[i];
-
-                        // remove this object from obj buffer
-                        for (int j = i + 1; j < this->object_count; j++)
-                        {
-                            this->object_buffer[j - 1] = this->object_buffer[j];
-                        }
-
-                        this->object_count--;
-
-                        break;
-                    }
+                this->sprite_fetcher.tile_id = sp.tile;
+                if (GET_BIT(lcd_control, 2) && ly + 16 >= sp.y_pos + 8)
+                {
+                    SET_BIT(this->sprite_fetcher.tile_id, 0);
                 }
+
+                this->current_rendering_sprite = sp;
             }
             else
             {
                 uint16_t offset = (this->background_fetcher.fetcher_x_position);
-                uint8_t bit = 0;
                 if (this->fetcher_type == BACKGROUND)
                 {
-                    bit = GET_BIT(lcd_control, 3);
+                    map_location = this->bg_map_address;
 
                     offset = (offset + ((scx / 8)));
                     offset %= 0x20;
@@ -147,19 +142,10 @@ void PPU::Tick(uint8_t cycles)
                 }
                 else
                 {
-                    bit = GET_BIT(lcd_control, 6);
+                    map_location = this->window_map_address;
                     offset += 32 * (this->window_line_counter / 8);
                 }
 
-                if (bit)
-                {
-                    map_location = 0x9C00; // 0x9C00 - 0x9FFF
-                }
-                else
-                {
-                    map_location = 0x9800; // 0x9800 - 9BFF
-                }
-
                 map_location += (offset % 0x4000);
                 this->background_fetcher.tile_id = ReadVRAM(map_location);
             }
@@ -227,17 +213,19 @@ void PPU::Tick(uint8_t cycles)
                     this->internal_clock -= 2;
                     this->scanline_time += 2;
 
-                    uint8_t b0 = this->gb->mmu->Read(this->sprite_fetcher.tile_high_data);
-                    uint8_t b1 = this->gb->mmu->Read(this->sprite_fetcher.tile_low_data);
-
                     bool flipped = GET_BIT(current_rendering_sprite.flags, 5);
+                    const uint8_t* tile_row = this->GetTileRow(this->sprite_fetcher.tile_low_data - 0x8000, flipped);
 
-                    uint8_t obp0 = this->gb->mmu->Read(0xFF48);
-                    uint8_t obp1 = this->gb->mmu->Read(0xFF49);
-
-                    uint8_t bgp = this->gb->mmu->Read(0xFF47);
+                    uint8_t attributes = 0;
+                    if (GET_BIT(current_rendering_sprite.flags, 4))
+                    {
+                        attributes |= FIFO_OBJ_PALETTE;
+                    }
+                    if (GET_BIT(current_rendering_sprite.flags, 7))
+                    {
+                        attributes |= FIFO_OBJ_BEHIND_BG;
+                    }
 
-                    uint8_t color = 0;
                     for (uint8_t i = 0; i < 8; i++)
                     {
                         uint8_t pixel_x = current_rendering_sprite.x_pos + i;
@@ -247,40 +235,13 @@ void PPU::Tick(uint8_t cycles)
                         }
 
                         uint8_t fifo_id = pixel_x - (this->current_line_x + 8);
+                        uint8_t& pixel = this->fifo[(this->fifo_head + fifo_id) & (FIFO_SIZE - 1)];
 
-                        if (flipped)
+                        // mix fifo, opaque pixels of objects fetched earlier win
+                        uint8_t color = tile_row[i];
+                        if (color > 0 && FIFO_OBJ_COLOR(pixel) == 0)
                         {
-                            color = (GET_BIT(b0, i) << 1) | GET_BIT(b1, i);
-                        }
-                        else
-                        {
-                            color = (GET_BIT(b0, 7 - i) << 1) | GET_BIT(b1, 7 - i);
-                        }
-
-                        // mix fifo
-                        if (color > 0)
-                        {
-                            if (GET_BIT(current_rendering_sprite.flags, 7))
-                            {
-                                if (this->fifo[fifo_id].color != (GET_BIT(bgp, 0) | (GET_BIT(bgp, 1) << 1)))
-                                {
-                                    continue;
-                                }
-                            }
-
-                            if (GET_BIT(current_rendering_sprite.flags, 4))
-                            {
-                                // OBP1
-                                color = GET_BIT(obp1, color * 2) | (GET_BIT(obp1, color * 2 + 1) << 1);
-                            }
-                            else
-                            {
-                                // OBP0
-                                color = GET_BIT(obp0, color * 2) | (GET_BIT(obp0, color * 2 + 1) << 1);
-                            }  
-
-                            this->fifo[fifo_id].color = color;
-                            this->fifo[fifo_id].type = SPRITE;
+                            pixel |= (color << FIFO_OBJ_COLOR_SHIFT) | attributes;
                         }
                     }
 
@@ -297,18 +258,12 @@ void PPU::Tick(uint8_t cycles)
 
                         this->background_fetcher.fetcher_x_position++;
 
-                        uint8_t b0 = this->gb->mmu->Read(this->background_fetcher.tile_high_data);
-                        uint8_t b1 = this->gb->mmu->Read(this->background_fetcher.tile_low_data);
-
-                        uint8_t bgp = this->gb->mmu->Read(0xFF47);
+                        const uint8_t* tile_row = this->GetTileRow(this->background_fetcher.tile_low_data - 0x8000, false);
 
+                        uint8_t tail = this->fifo_head + this->fifo_pixel_count;
                         for (uint8_t i = 0; i < 8; i++)
                         {
-                            uint8_t color = (GET_BIT(b0, 7 - i) << 1) | GET_BIT(b1, 7 - i);
-                            uint8_t palette_color = GET_BIT(bgp, color * 2) | (GET_BIT(bgp, color * 2 + 1) << 1);
-                            
-                            this->fifo[this->fifo_pixel_count + i].color = palette_color;
-                            this->fifo[this->fifo_pixel_count + i].type = BACKGROUND;
+                            this->fifo[(tail + i) & (FIFO_SIZE - 1)] = tile_row[i];
                         }
 
                         this->fifo_pixel_count += 8;
@@ -324,16 +279,15 @@ void PPU::Tick(uint8_t cycles)
     else if(this->mode == 0)
     {
         // go to next scanline
-        uint8_t ly = this->gb->mmu->Read(0xFF44);
-
         if(this->reached_window_in_frame)
         {
             this->window_line_counter++;
         }
 
-        this->gb->mmu->Write(0xFF44, ly + 1);
+        this->ly = ly + 1;
         
         this->current_line_x = 0;
+        this->scanline_time = 0;
 
         if(ly == 143)
         {
@@ -353,11 +307,10 @@ void PPU::Tick(uint8_t cycles)
         {
             this->internal_clock -= 456;
 
-            uint8_t ly = this->gb->mmu->Read(0xFF44);
-            if (ly >= 153)
+            if (this->ly >= 153)
             {
                 // if it reached the end of vblank then reset scanline y
-                this->gb->mmu->Write(0xFF44, 0);
+                this->ly = 0;
                 this->SwitchMode(2);
 
                 this->requested_vram_debug_update = true;
@@ -365,7 +318,8 @@ void PPU::Tick(uint8_t cycles)
             else
             {
                 // go to next vblank scanline
-                this->gb->mmu->Write(0xFF44, ly + 1);
+                this->ly++;
+                this->UpdateSTATLine();
             }
         }
     }
@@ -373,109 +327,221 @@ void PPU::Tick(uint8_t cycles)
 
 void PPU::PushToLCD(uint8_t cycles)
 {
-    if (this->fifo_pixel_count > 8 && this->fetcher_type != SPRITE)
+    if (this->fifo_pixel_count <= 8 || this->fetcher_type == SPRITE)
+    {
+        return;
+    }
+
+    uint8_t ly = this->ly;
+    uint8_t scx = this->scx;
+
+    if(this->wy == ly)
+    {
+        reached_window_in_frame = true;
+    }
+
+    // first x where the background fetcher switches to the window
+    int window_x = 0x7FFF;
+    if (this->fetcher_type == BACKGROUND && GET_BIT(this->lcdc, 5) && this->reached_window_in_frame)
     {
-        uint8_t ly = this->gb->mmu->Read(0xFF44);
-        uint8_t scx = this->gb->mmu->Read(0xFF43);
-        uint8_t lcdc = this->gb->mmu->Read(0xFF40);
-        uint8_t wy = this->gb->mmu->Read(0xFF4A);
-        uint8_t wx = this->gb->mmu->Read(0xFF4B);
+        window_x = this->wx - 7;
+    }
+
+    uint8_t* line = &this->screen_pixels[ly * 160];
 
-        if(wy == ly)
+    this->fifo_clock += cycles * 4;
+
+    // shift out as many pixels as the cycles allow, the fetcher refills the fifo on the next tick
+    while (this->fifo_clock > 0 && this->fifo_pixel_count > 8)
+    {
+        this->fifo_clock--;
+
+        // window fetch
+        if (this->current_line_x >= window_x)
         {
-            reached_window_in_frame = true;
+            this->fifo_pixel_count = 0;
+            this->background_fetcher.fetcher_x_position = 0;
+            this->fetcher_stage = 0;
+            this->fetcher_type = WINDOW;
+            return;
         }
 
-        this->fifo_clock += cycles * 4;
+        // object at the current x
+        if (this->object_cursor < this->object_count && this->object_buffer[this->object_cursor].x_pos <= this->current_line_x + 8)
+        {
+            this->fetcher_stage = 0;
+            this->fetcher_type = SPRITE;
+            return;
+        }
 
-        while (this->fifo_clock > 0)
+        // pop current pixel
+        uint8_t pixel = this->fifo[this->fifo_head];
+        this->fifo_head = (this->fifo_head + 1) & (FIFO_SIZE - 1);
+        this->fifo_pixel_count--;
+
+        // ignore if pixel is in the scroll
+        if (this->line_processed_pixel_count < scx % 8)
         {
-            if (this->fifo_pixel_count <= 8 || this->fetcher_type == SPRITE)
-            {
-                break;
-            }
+            this->line_processed_pixel_count++;
+            continue;
+        }
 
-            this->fifo_clock--;
+        this->line_processed_pixel_count++;
 
-            if(this->fetcher_type == BACKGROUND)
-            {
-                // window fetch
-                if(GET_BIT(lcdc, 5))
-                {
-                    if(reached_window_in_frame)
-                    {
-                        if(current_line_x >= wx - 7)
-                        {
-                            this->fifo_pixel_count = 0;
-                            this->background_fetcher.fetcher_x_position = 0;
-                            this->fetcher_stage = 0;
-                            this->fetcher_type = WINDOW;
-                            return;
-                        }
-                    }
-                }
-            }
+        // set screen pixel
+        line[this->current_line_x] = this->fifo_shades[pixel];
+        this->current_line_x++;
 
-            // check objects in current X
-            for (int i = 0; i < this->object_count; i++)
-            {
-                if (this->object_buffer[i].x_pos <= this->current_line_x + 8)
-                {
-                    this->fetcher_stage = 0;
-                    this->fetcher_type = SPRITE;
-                    return;
-                }
-            }
+        if (this->current_line_x == 160)
+        {
+            this->SwitchMode(0);
+            break;
+        }
+    }
+}
 
-            // pop current pixel
-            FIFOPixel pixel = this->fifo[0];
+uint16_t PPU::GetScanlineDrawingTime(uint8_t ly)
+{
+    const ScanlineRegisters& r = this->line_job.segments[0].registers;
 
-            for (int i = 1; i < this->fifo_pixel_count; i++)
-            {
-                this->fifo[i - 1] = this->fifo[i];
-            }
+    // 172 dots plus the discarded fine scroll pixels, the window restart and the object fetches
+    uint16_t dots = 172 + (r.scx % 8) + 6 * this->object_count;
 
-            this->fifo_pixel_count--;
+    if (GET_BIT(r.lcdc, 5) && (this->reached_window_in_frame || r.wy == ly) && r.wx <= 166)
+    {
+        dots += 6;
+    }
 
-            // ignore if pixel is in the scroll
-            if (this->line_processed_pixel_count < scx % 8)
-            {
-                this->line_processed_pixel_count++;
-                continue;
-            }
+    return dots;
+}
 
-            this->line_processed_pixel_count++;
+void PPU::RenderScanline()
+{
+    uint8_t ly = this->ly;
 
-            // set screen pixel
-            this->screen_pixels[this->current_line_x + ly * 160] = pixel.color;
-            this->current_line_x++;
+    if (this->line_job.segments[0].registers.wy == ly)
+    {
+        this->reached_window_in_frame = true;
+    }
 
-            if (this->current_line_x == 160)
-            {
-                this->SwitchMode(0);
-                break;
-            }
-        }
+    this->line_job.ly = ly;
+    this->line_job.window_line = this->window_line_counter;
+    this->line_job.window_reached = this->reached_window_in_frame;
+
+    memcpy(this->line_job.objects, this->object_buffer, this->object_count * sizeof(Sprite));
+    this->line_job.object_count = this->object_count;
+
+    uint8_t* line = &this->screen_pixels[ly * 160];
+
+    if (this->render_thread != nullptr)
+    {
+        this->render_thread->QueueLine(this->line_job, line);
+    }
+    else
+    {
+        ::RenderScanline(this->video_memory, this->line_job, *this->kernels, line);
     }
 }
 
+void PPU::LogRegisterWrite(uint16_t address, uint8_t data)
+{
+    // pixels come out during the last 160 dots of mode 3, the fetch and object delays come first
+    int x = (int)this->internal_clock - (this->pause_time - 160);
+    if (x >= 160)
+    {
+        return;
+    }
+
+    x = std::max(x, 0);
+
+    ScanlineSegment* segment = &this->line_job.segments[this->line_job.segment_count - 1];
+
+    // only registers the renderer reads take a segment, and only when they change
+    uint8_t* reg = GetSegmentRegister(segment->registers, address);
+    if (reg == nullptr || *reg == data)
+    {
+        return;
+    }
+
+    // a full log applies later writes from the last segment on
+    if (segment->x != x && this->line_job.segment_count < SCANLINE_MAX_SEGMENTS)
+    {
+        this->line_job.segments[this->line_job.segment_count] = { (uint8_t)x, segment->registers };
+        segment = &this->line_job.segments[this->line_job.segment_count];
+        this->line_job.segment_count++;
+    }
+
+    *GetSegmentRegister(segment->registers, address) = data;
+}
+
+uint8_t* PPU::GetSegmentRegister(ScanlineRegisters& registers, uint16_t address)
+{
+    switch (address)
+    {
+    case 0xFF40: return &registers.lcdc;
+    case 0xFF42: return &registers.scy;
+    case 0xFF43: return &registers.scx;
+    case 0xFF47: return &registers.bgp;
+    case 0xFF48: return &registers.obp0;
+    case 0xFF49: return &registers.obp1;
+    case 0xFF4A: return &registers.wy;
+    case 0xFF4B: return &registers.wx;
+    default:
+        return nullptr;
+    }
+}
+
+void PPU::SwapFramebuffers()
+{
+    // lines queued on the worker belong to the finished frame
+    if (this->render_thread != nullptr)
+    {
+        this->render_thread->WaitIdle();
+    }
+
+    uint64_t frame = this->frame_count.load(std::memory_order_relaxed) + 1;
+
+    // the finished frame becomes the front buffer, the old front buffer is drawn over next
+    this->screen_pixels = this->framebuffers[frame & 1];
+    this->frame_count.store(frame, std::memory_order_release);
+
+    this->gb->OnFrameComplete();
+}
+
 uint8_t PPU::ReadVRAM(uint32_t address)
 {
     assert(address >= 0x8000 && address <= 0x9FFF);
 
-    return this->vram[address - 0x8000];
+    return this->video_memory.Read(address - 0x8000);
 }
 
 void PPU::WriteVRAM(uint32_t address, uint8_t data)
 {
     assert(address >= 0x8000 && address <= 0x9FFF);
 
-    this->vram[address - 0x8000] = data;
+    uint16_t offset = address - 0x8000;
+    if (this->video_memory.Write(offset, data) && this->render_thread != nullptr)
+    {
+        this->render_thread->QueueVRAMWrite(offset, data);
+    }
 }
 
-bool PPU::IsVRAMAcessible()
+void PPU::SetRenderThread(bool enabled)
 {
-    return mode != 3;
+    if (enabled == this->IsRenderThreadEnabled())
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        this->render_thread = new RenderThread(this->video_memory);
+    }
+    else
+    {
+        delete this->render_thread;
+        this->render_thread = nullptr;
+    }
 }
 
 uint8_t PPU::ReadOAM(uint32_t address)
@@ -490,32 +556,194 @@ void PPU::WriteOAM(uint32_t address, uint8_t data)
     assert(address >= 0xFE00 && address <= 0xFE9F);
 
     //std::cout << "New oam data: " << (uint32_t)data << std::endl;
-    this->oam[address - 0xFE00] = data;
+    uint8_t offset = address - 0xFE00;
+
+    // only y and x decide which lines an object is on
+    if ((offset % 4) < 2 && this->oam[offset] != data)
+    {
+        this->line_objects_dirty = true;
+    }
+
+    this->oam[offset] = data;
 }
 
-uint16_t PPU::GetTile(uint8_t id, bool obj)
+void PPU::WriteOAMBlock(const uint8_t* data)
 {
-    uint8_t LCDC = this->gb->mmu->Read(0xFF40);
+    if (memcmp(this->oam, data, sizeof(this->oam)) != 0)
+    {
+        memcpy(this->oam, data, sizeof(this->oam));
+        this->line_objects_dirty = true;
+    }
+}
 
-    if(obj || (LCDC & 0x10))
+void PPU::BuildLineObjects(uint8_t sprite_height)
+{
+    memset(this->line_object_counts, 0, sizeof(this->line_object_counts));
+
+    for (uint8_t i = 0; i < 40; i++)
     {
-        // 0x8000 method
-        return (0x8000 + id * 0x10);
+        uint8_t y_pos = this->oam[4 * i];
+        uint8_t x_pos = this->oam[4 * i + 1];
+
+        if (x_pos == 0)
+        {
+            continue;
+        }
+
+        // lines where ly + 16 is in [y_pos, y_pos + sprite_height)
+        int first = std::max(y_pos - 16, 0);
+        int last = std::min(y_pos - 16 + sprite_height, 144);
+
+        for (int line = first; line < last; line++)
+        {
+            uint8_t& count = this->line_object_counts[line];
+            if (count < 10)
+            {
+                this->line_objects[line][count] = i;
+                count++;
+            }
+        }
     }
-    else if((LCDC & 0x10) == 0)
+
+    this->line_objects_dirty = false;
+}
+
+void PPU::BuildPaletteTables()
+{
+    for (uint8_t color = 0; color < 4; color++)
     {
-        // 0x8800 method 
-        if(id >= 128 && id < 256)
+        this->bgp_shades[color] = (this->bgp >> (color * 2)) & 0x03;
+        this->obp0_shades[color] = (this->obp0 >> (color * 2)) & 0x03;
+        this->obp1_shades[color] = (this->obp1 >> (color * 2)) & 0x03;
+    }
+
+    for (uint16_t pixel = 0; pixel < 256; pixel++)
+    {
+        uint8_t color = FIFO_BG_COLOR(pixel);
+        uint8_t obj_color = FIFO_OBJ_COLOR(pixel);
+
+        if (obj_color != 0 && ((pixel & FIFO_OBJ_BEHIND_BG) == 0 || color == 0))
         {
-            return (0x8800 + (id-128) * 0x10);
+            this->fifo_shades[pixel] = (pixel & FIFO_OBJ_PALETTE) ? this->obp1_shades[obj_color] : this->obp0_shades[obj_color];
         }
         else
         {
-            return (0x9000 + id * 0x10);
+            this->fifo_shades[pixel] = this->bgp_shades[color];
         }
     }
+}
 
-    return 0x0;
+uint16_t PPU::GetTile(uint8_t id, bool obj)
+{
+    if(obj || this->tile_data_address == 0x8000)
+    {
+        // 0x8000 method
+        return (0x8000 + id * 0x10);
+    }
+
+    // 0x8800 method, signed ids around 0x9000
+    return (0x9000 + (int8_t)id * 0x10);
+}
+
+uint8_t PPU::ReadRegister(uint16_t address)
+{
+    switch (address)
+    {
+    case 0xFF40: return this->lcdc;
+    case 0xFF41: return 0x80 | (this->stat & 0x7C) | this->mode; // bit 7 is unused and reads as 1
+    case 0xFF42: return this->scy;
+    case 0xFF43: return this->scx;
+    case 0xFF44: return this->ly;
+    case 0xFF45: return this->lyc;
+    case 0xFF47: return this->bgp;
+    case 0xFF48: return this->obp0;
+    case 0xFF49: return this->obp1;
+    case 0xFF4A: return this->wy;
+    case 0xFF4B: return this->wx;
+    default:
+        return 0xFF;
+    }
+}
+
+void PPU::WriteRegister(uint16_t address, uint8_t data)
+{
+    // the scanline renderer draws at the end of mode 3, writes in between are replayed from a log
+    if (this->mode == 3 && this->line_render_mode == PPU_RENDER_SCANLINE && !this->skip_frame)
+    {
+        this->LogRegisterWrite(address, data);
+    }
+
+    switch (address)
+    {
+    case 0xFF40:
+    {
+        uint8_t changed = this->lcdc ^ data;
+
+        // object height decides which lines the objects are on
+        if (GET_BIT(changed, 2))
+        {
+            this->line_objects_dirty = true;
+        }
+
+        this->lcdc = data;
+        this->tile_data_address = GET_BIT(data, 4) ? 0x8000 : 0x9000;
+        this->bg_map_address = GET_BIT(data, 3) ? 0x9C00 : 0x9800;
+        this->window_map_address = GET_BIT(data, 6) ? 0x9C00 : 0x9800;
+
+        if (GET_BIT(changed, 7))
+        {
+            if (GET_BIT(data, 7))
+            {
+                this->TurnOnLCD();
+            }
+            else
+            {
+                // the screen stays blank while the lcd is off
+                if (this->render_thread != nullptr)
+                {
+                    this->render_thread->WaitIdle();
+                }
+
+                memset(this->screen_pixels, 0, 160 * 144);
+                if (!this->skip_frame)
+                {
+                    this->SwapFramebuffers();
+                }
+
+                this->TurnOffLCD();
+            }
+        }
+        break;
+    }
+    case 0xFF41:
+        // the mode and the coincidence flag are read only
+        this->stat = (this->stat & 0x07) | (data & 0x78);
+        this->UpdateSTATLine();
+        break;
+    case 0xFF42: this->scy = data; break;
+    case 0xFF43: this->scx = data; break;
+    case 0xFF44: break; // read only
+    case 0xFF45:
+        this->lyc = data;
+        this->UpdateSTATLine();
+        break;
+    case 0xFF47:
+        this->bgp = data;
+        this->BuildPaletteTables();
+        break;
+    case 0xFF48:
+        this->obp0 = data;
+        this->BuildPaletteTables();
+        break;
+    case 0xFF49:
+        this->obp1 = data;
+        this->BuildPaletteTables();
+        break;
+    case 0xFF4A: this->wy = data; break;
+    case 0xFF4B: this->wx = data; break;
+    default:
+        break;
+    }
 }
 
 void PPU::SwitchMode(uint8_t m)
@@ -525,28 +753,29 @@ void PPU::SwitchMode(uint8_t m)
         return;
     }
 
-    uint8_t ly = this->gb->mmu->Read(0xFF44);
-    uint8_t lcd_status = this->gb->mmu->Read(0xFF41);
-    uint8_t lcd_control = this->gb->mmu->Read(0xFF40);
-
-    CLEAR_BIT(lcd_status, 3);
-    CLEAR_BIT(lcd_status, 4);
-    CLEAR_BIT(lcd_status, 5);
+    uint8_t ly = this->ly;
+    uint8_t lcd_control = this->lcdc;
 
     if(m == 2) // OAM Scan
     {
-        SET_BIT(lcd_status, 5);
-
         uint8_t sprite_height = (lcd_control & 0x04) ? 16 : 8;
 
         this->pause_time = 80;  
 
-        // scan for objects on this scanline
+        if (this->line_objects_dirty)
+        {
+            this->BuildLineObjects(sprite_height);
+        }
+
+        // objects of this line sorted by x, oam order breaks ties
         this->object_count = 0;
-        for(int i = 0; i < 40; i++)
+        this->object_cursor = 0;
+
+        uint8_t count = (ly < 144) ? this->line_object_counts[ly] : 0;
+        for (uint8_t i = 0; i < count; i++)
         {
-            uint16_t address = 4 * i;
-            
+            uint16_t address = 4 * this->line_objects[ly][i];
+
             Sprite sp;
 
             sp.y_pos = this->oam[address];
@@ -554,28 +783,21 @@ void PPU::SwitchMode(uint8_t m)
             sp.tile = this->oam[address + 2];
             sp.flags = this->oam[address + 3];
 
-            if (sp.x_pos > 0)
+            if (sprite_height == 16)
             {
-                if (ly + 16 >= sp.y_pos)
-                {
-                    if (ly + 16 < sp.y_pos + sprite_height)
-                    {
-                        if (sprite_height == 16)
-                        {
-                            CLEAR_BIT(sp.tile, 0);
-                        }
-
-                        this->object_buffer[this->object_count] = sp;
-                        this->object_count++;
+                CLEAR_BIT(sp.tile, 0);
+            }
 
-                        if (this->object_count >= 10)
-                        {
-                            break;
-                        }
-                    }
-                }
+            int j = this->object_count;
+            while (j > 0 && this->object_buffer[j - 1].x_pos > sp.x_pos)
+            {
+                this->object_buffer[j] = this->object_buffer[j - 1];
+                j--;
             }
-        }  
+
+            this->object_buffer[j] = sp;
+            this->object_count++;
+        }
     }
     else if(m == 3) // Drawing
     {
@@ -585,12 +807,32 @@ void PPU::SwitchMode(uint8_t m)
         this->background_fetcher.fetcher_x_position = 0;
         this->fetcher_type = BACKGROUND;
 
+        this->fifo_head = 0;
         this->fifo_pixel_count = 0;
+        this->object_cursor = 0;
+
+        // skipped frames use the scanline timing without drawing
+        this->line_render_mode = this->skip_frame ? PPU_RENDER_SCANLINE : this->render_mode;
+        if (this->line_render_mode == PPU_RENDER_SCANLINE)
+        {
+            this->line_job.segment_count = 1;
+            this->line_job.segments[0].x = 0;
+
+            ScanlineRegisters& r = this->line_job.segments[0].registers;
+            r.lcdc = lcd_control;
+            r.scy = this->scy;
+            r.scx = this->scx;
+            r.wy = this->wy;
+            r.wx = this->wx;
+            r.bgp = this->bgp;
+            r.obp0 = this->obp0;
+            r.obp1 = this->obp1;
+
+            this->pause_time = this->GetScanlineDrawingTime(ly);
+        }
     }
     else if(m == 0) // H-Blank
     {
-        SET_BIT(lcd_status, 3);
-
         if(this->scanline_time < 456)
         {
             this->pause_time = 456 - this->scanline_time;
@@ -599,14 +841,76 @@ void PPU::SwitchMode(uint8_t m)
     }
     else if(m == 1) // V-Blank
     {
-        SET_BIT(lcd_status, 4);
-
         this->gb->cpu->SetInterruptFlag(0, true);
+
+        if (!this->skip_frame)
+        {
+            this->SwapFramebuffers();
+        }
+
+        // draw one frame, then skip frame_skip frames
+        this->skip_frame = this->skipped_frames < this->frame_skip;
+        this->skipped_frames = this->skip_frame ? this->skipped_frames + 1 : 0;
+
         this->window_line_counter = 0;
         this->reached_window_in_frame = false;
     }
     
     this->mode = m;
+    this->UpdateSTATLine();
+
+    // the cpu can't reach oam during the oam scan and drawing, or vram while drawing
+    this->gb->mmu->SetVideoMemoryLocks(m == 3, m == 2 || m == 3);
+}
+
+void PPU::TurnOffLCD()
+{
+    // LY is held at 0 in mode 0, Tick returns right away until LCDC.7 is set again
+    this->mode = 0;
+    this->ly = 0;
+    this->internal_clock = 0;
+    this->pause_time = 0;
+    this->scanline_time = 0;
+    this->fifo_clock = 0;
+
+    this->UpdateSTATLine();
+    this->gb->mmu->SetVideoMemoryLocks(false, false);
+}
+
+void PPU::TurnOnLCD()
+{
+    // starts over at the top of a new frame
+    this->window_line_counter = 0;
+    this->reached_window_in_frame = false;
+    this->internal_clock = 0;
+    this->scanline_time = 0;
+
+    this->SwitchMode(2);
+}
+
+void PPU::UpdateSTATLine()
+{
+    bool coincidence = this->ly == this->lyc;
+    if (coincidence)
+    {
+        SET_BIT(this->stat, 2);
+    }
+    else
+    {
+        CLEAR_BIT(this->stat, 2);
+    }
+
+    // the interrupt sources share one line, IF is only set when it goes from low to high.
+    // The line stays low while the lcd is off.
+    bool line = GET_BIT(this->lcdc, 7) && ((GET_BIT(this->stat, 6) && coincidence)
+        || (GET_BIT(this->stat, 5) && this->mode == 2)
+        || (GET_BIT(this->stat, 4) && this->mode == 1)
+        || (GET_BIT(this->stat, 3) && this->mode == 0));
+
+    if (line && !this->stat_line)
+    {
+        this->gb->cpu->SetInterruptFlag(1, true);
+    }
 
-    this->gb->mmu->Write(0xFF41, lcd_status);
+    this->stat_line = line;
 }
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include "PixelKernels.h"
+#include "BitwiseUtils.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PIXEL_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// gcc and clang only emit avx2/bmi2 instructions in functions marked for them,
+// msvc accepts the intrinsics anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define KERNEL_TARGET(x) __attribute__((target(x)))
+#else
+#define KERNEL_TARGET(x)
+#endif
+
+// Scalar reference, also used for the tails of the vector paths
+
+static void DecodeTileRowScalar(uint8_t low, uint8_t high, uint8_t* out, uint8_t* out_flipped)
+{
+    for (uint8_t x = 0; x < 8; x++)
+    {
+        uint8_t color = (GET_BIT(high, 7 - x) << 1) | GET_BIT(low, 7 - x);
+        out[x] = color;
+        out_flipped[7 - x] = color;
+    }
+}
+
+static void DecodeTileRowsScalar(const uint8_t* planar, uint32_t row_count, uint8_t* out, uint8_t* out_flipped)
+{
+    for (uint32_t i = 0; i < row_count; i++)
+    {
+        DecodeTileRowScalar(planar[i * 2], planar[i * 2 + 1], out + i * 8, out_flipped + i * 8);
+    }
+}
+
+static void MapPaletteScalar(const uint8_t* ids, uint8_t palette, uint8_t* out, uint32_t count)
+{
+    const uint8_t shades[4] = {
+        (uint8_t)(palette & 0x03), (uint8_t)((palette >> 2) & 0x03), (uint8_t)((palette >> 4) & 0x03), (uint8_t)((palette >> 6) & 0x03)
+    };
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = shades[ids[i] & 0x03];
+    }
+}
+
+static void ExpandShades8Scalar(const uint8_t* shades, const uint8_t* lut, uint8_t* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = lut[shades[i] & 0x03];
+    }
+}
+
+static void ExpandShades16Scalar(const uint8_t* shades, const uint16_t* lut, uint16_t* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = lut[shades[i] & 0x03];
+    }
+}
+
+static void ExpandShades32Scalar(const uint8_t* shades, const uint32_t* lut, uint32_t* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = lut[shades[i] & 0x03];
+    }
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+// SSE2, part of every x86-64 cpu
+
+// Turns two rows of broadcast low and high bytes into color ids
+static inline __m128i DecodePlanesSSE2(__m128i lows, __m128i highs, __m128i bits)
+{
+    __m128i low_set = _mm_cmpeq_epi8(_mm_and_si128(lows, bits), bits);
+    __m128i high_set = _mm_cmpeq_epi8(_mm_and_si128(highs, bits), bits);
+
+    return _mm_or_si128(_mm_and_si128(low_set, _mm_set1_epi8(1)), _mm_and_si128(high_set, _mm_set1_epi8(2)));
+}
+
+// Bytes l0 h0 l1 h1 become lows = l0 x8, l1 x8 and highs = h0 x8, h1 x8
+static inline void BroadcastPlanesSSE2(uint32_t planar, __m128i& lows, __m128i& highs)
+{
+    __m128i v = _mm_cvtsi32_si128((int)planar);
+    v = _mm_unpacklo_epi8(v, v);
+    v = _mm_unpacklo_epi16(v, v);
+
+    lows = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 0, 0));
+    highs = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 1, 1));
+}
+
+static void DecodeTileRowSSE2(uint8_t low, uint8_t high, uint8_t* out, uint8_t* out_flipped)
+{
+    __m128i lows;
+    __m128i highs;
+    BroadcastPlanesSSE2(low | (high << 8), lows, highs);
+
+    const __m128i bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i bits_flipped = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    _mm_storel_epi64((__m128i*)out, DecodePlanesSSE2(lows, highs, bits));
+    _mm_storel_epi64((__m128i*)out_flipped, DecodePlanesSSE2(lows, highs, bits_flipped));
+}
+
+static void DecodeTileRowsSSE2(const uint8_t* planar, uint32_t row_count, uint8_t* out, uint8_t* out_flipped)
+{
+    const __m128i bits = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+        (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const __m128i bits_flipped = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80);
+
+    // two rows, 16 pixels per step
+    uint32_t i = 0;
+    for (; i + 2 <= row_count; i += 2)
+    {
+        uint32_t pair;
+        memcpy(&pair, planar + i * 2, sizeof(pair));
+
+        __m128i lows;
+        __m128i highs;
+        BroadcastPlanesSSE2(pair, lows, highs);
+
+        _mm_storeu_si128((__m128i*)(out + i * 8), DecodePlanesSSE2(lows, highs, bits));
+        _mm_storeu_si128((__m128i*)(out_flipped + i * 8), DecodePlanesSSE2(lows, highs, bits_flipped));
+    }
+
+    DecodeTileRowsScalar(planar + i * 2, row_count - i, out + i * 8, out_flipped + i * 8);
+}
+
+static void MapPaletteSSE2(const uint8_t* ids, uint8_t palette, uint8_t* out, uint32_t count)
+{
+    const __m128i shade0 = _mm_set1_epi8(palette & 0x03);
+    const __m128i shade1 = _mm_set1_epi8((palette >> 2) & 0x03);
+    const __m128i shade2 = _mm_set1_epi8((palette >> 4) & 0x03);
+    const __m128i shade3 = _mm_set1_epi8((palette >> 6) & 0x03);
+
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(ids + i));
+
+        __m128i r = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()), shade0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(1)), shade1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(2)), shade2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(3)), shade3));
+
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+
+    MapPaletteScalar(ids + i, palette, out + i, count - i);
+}
+
+static void ExpandShades8SSE2(const uint8_t* shades, const uint8_t* lut, uint8_t* out, uint32_t count)
+{
+    const __m128i color0 = _mm_set1_epi8((char)lut[0]);
+    const __m128i color1 = _mm_set1_epi8((char)lut[1]);
+    const __m128i color2 = _mm_set1_epi8((char)lut[2]);
+    const __m128i color3 = _mm_set1_epi8((char)lut[3]);
+
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(shades + i));
+
+        __m128i r = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()), color0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(1)), color1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(2)), color2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(3)), color3));
+
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+
+    ExpandShades8Scalar(shades + i, lut, out + i, count - i);
+}
+
+static void ExpandShades16SSE2(const uint8_t* shades, const uint16_t* lut, uint16_t* out, uint32_t count)
+{
+    const __m128i color0 = _mm_set1_epi16((short)lut[0]);
+    const __m128i color1 = _mm_set1_epi16((short)lut[1]);
+    const __m128i color2 = _mm_set1_epi16((short)lut[2]);
+    const __m128i color3 = _mm_set1_epi16((short)lut[3]);
+
+    // 8 pixels per step, shades widened to words
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(shades + i)), _mm_setzero_si128());
+
+        __m128i r = _mm_and_si128(_mm_cmpeq_epi16(v, _mm_setzero_si128()), color0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(1)), color1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(2)), color2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(3)), color3));
+
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+
+    ExpandShades16Scalar(shades + i, lut, out + i, count - i);
+}
+
+static void ExpandShades32SSE2(const uint8_t* shades, const uint32_t* lut, uint32_t* out, uint32_t count)
+{
+    const __m128i color0 = _mm_set1_epi32((int)lut[0]);
+    const __m128i color1 = _mm_set1_epi32((int)lut[1]);
+    const __m128i color2 = _mm_set1_epi32((int)lut[2]);
+    const __m128i color3 = _mm_set1_epi32((int)lut[3]);
+
+    // 4 pixels per step, shades widened to dwords
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t packed;
+        memcpy(&packed, shades + i, sizeof(packed));
+
+        __m128i v = _mm_cvtsi32_si128((int)packed);
+        v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, _mm_setzero_si128()), _mm_setzero_si128());
+
+        __m128i r = _mm_and_si128(_mm_cmpeq_epi32(v, _mm_setzero_si128()), color0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi32(v, _mm_set1_epi32(1)), color1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi32(v, _mm_set1_epi32(2)), color2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_cmpeq_epi32(v, _mm_set1_epi32(3)), color3));
+
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+
+    ExpandShades32Scalar(shades + i, lut, out + i, count - i);
+}
+
+// AVX2 and BMI2
+
+KERNEL_TARGET("bmi2")
+static void DecodeTileRowBMI2(uint8_t low, uint8_t high, uint8_t* out, uint8_t* out_flipped)
+{
+    // pdep puts bit 0 (the rightmost pixel) in byte 0, which is the mirrored row
+    uint64_t flipped = _pdep_u64(low, 0x0101010101010101ull) | _pdep_u64(high, 0x0202020202020202ull);
+
+#if defined(_MSC_VER)
+    uint64_t row = _byteswap_uint64(flipped);
+#else
+    uint64_t row = __builtin_bswap64(flipped);
+#endif
+
+    memcpy(out, &row, sizeof(row));
+    memcpy(out_flipped, &flipped, sizeof(flipped));
+}
+
+KERNEL_TARGET("avx2")
+static void DecodeTileRowsAVX2(const uint8_t* planar, uint32_t row_count, uint8_t* out, uint8_t* out_flipped)
+{
+    // rows 0 and 1 in the low lane, rows 2 and 3 in the high lane
+    const __m256i low_index = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2,
+        4, 4, 4, 4, 4, 4, 4, 4, 6, 6, 6, 6, 6, 6, 6, 6);
+    const __m256i high_index = _mm256_add_epi8(low_index, _mm256_set1_epi8(1));
+
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080ll);
+    const __m256i bits_flipped = _mm256_set1_epi64x((long long)0x8040201008040201ull);
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+
+    // four rows, 32 pixels per step
+    uint32_t i = 0;
+    for (; i + 4 <= row_count; i += 4)
+    {
+        long long rows;
+        memcpy(&rows, planar + i * 2, sizeof(rows));
+
+        __m256i v = _mm256_set1_epi64x(rows);
+        __m256i lows = _mm256_shuffle_epi8(v, low_index);
+        __m256i highs = _mm256_shuffle_epi8(v, high_index);
+
+        __m256i low_set = _mm256_cmpeq_epi8(_mm256_and_si256(lows, bits), bits);
+        __m256i high_set = _mm256_cmpeq_epi8(_mm256_and_si256(highs, bits), bits);
+        __m256i result = _mm256_or_si256(_mm256_and_si256(low_set, one), _mm256_and_si256(high_set, two));
+
+        low_set = _mm256_cmpeq_epi8(_mm256_and_si256(lows, bits_flipped), bits_flipped);
+        high_set = _mm256_cmpeq_epi8(_mm256_and_si256(highs, bits_flipped), bits_flipped);
+        __m256i result_flipped = _mm256_or_si256(_mm256_and_si256(low_set, one), _mm256_and_si256(high_set, two));
+
+        _mm256_storeu_si256((__m256i*)(out + i * 8), result);
+        _mm256_storeu_si256((__m256i*)(out_flipped + i * 8), result_flipped);
+    }
+
+    DecodeTileRowsSSE2(planar + i * 2, row_count - i, out + i * 8, out_flipped + i * 8);
+}
+
+KERNEL_TARGET("avx2")
+static void MapPaletteAVX2(const uint8_t* ids, uint8_t palette, uint8_t* out, uint32_t count)
+{
+    // ids are 0-3, so they index the first four bytes of each lane directly
+    __m128i lut = _mm_setr_epi8(palette & 0x03, (palette >> 2) & 0x03, (palette >> 4) & 0x03, (palette >> 6) & 0x03,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i lut2 = _mm256_broadcastsi128_si256(lut);
+
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(ids + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_shuffle_epi8(lut2, v));
+    }
+
+    MapPaletteSSE2(ids + i, palette, out + i, count - i);
+}
+
+KERNEL_TARGET("avx2")
+static void ExpandShades8AVX2(const uint8_t* shades, const uint8_t* lut, uint8_t* out, uint32_t count)
+{
+    __m128i table = _mm_setr_epi8((char)lut[0], (char)lut[1], (char)lut[2], (char)lut[3],
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i table2 = _mm256_broadcastsi128_si256(table);
+
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(shades + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_shuffle_epi8(table2, v));
+    }
+
+    ExpandShades8SSE2(shades + i, lut, out + i, count - i);
+}
+
+KERNEL_TARGET("avx2")
+static void ExpandShades16AVX2(const uint8_t* shades, const uint16_t* lut, uint16_t* out, uint32_t count)
+{
+    // separate tables for the low and high bytes, interleaved after the lookup
+    __m128i low_table = _mm_setr_epi8((char)lut[0], (char)lut[1], (char)lut[2], (char)lut[3],
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i high_table = _mm_setr_epi8((char)(lut[0] >> 8), (char)(lut[1] >> 8), (char)(lut[2] >> 8), (char)(lut[3] >> 8),
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m256i low_table2 = _mm256_broadcastsi128_si256(low_table);
+    __m256i high_table2 = _mm256_broadcastsi128_si256(high_table);
+
+    uint32_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(shades + i));
+        __m256i lows = _mm256_shuffle_epi8(low_table2, v);
+        __m256i highs = _mm256_shuffle_epi8(high_table2, v);
+
+        // unpack works per lane: a holds pixels 0-7 and 16-23, b holds 8-15 and 24-31
+        __m256i a = _mm256_unpacklo_epi8(lows, highs);
+        __m256i b = _mm256_unpackhi_epi8(lows, highs);
+
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + i + 16), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+
+    ExpandShades16SSE2(shades + i, lut, out + i, count - i);
+}
+
+KERNEL_TARGET("avx2")
+static void ExpandShades32AVX2(const uint8_t* shades, const uint32_t* lut, uint32_t* out, uint32_t count)
+{
+    __m256i table = _mm256_setr_epi32((int)lut[0], (int)lut[1], (int)lut[2], (int)lut[3], 0, 0, 0, 0);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(shades + i)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permutevar8x32_epi32(table, v));
+    }
+
+    ExpandShades32SSE2(shades + i, lut, out + i, count - i);
+}
+
+static void CPUID(int leaf, int subleaf, int registers[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex(registers, leaf, subleaf);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    registers[0] = a;
+    registers[1] = b;
+    registers[2] = c;
+    registers[3] = d;
+#endif
+}
+
+static uint64_t ReadXCR0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+struct CPUFeatures
+{
+    bool avx2 = false;
+    bool fast_bmi2 = false;
+};
+
+static CPUFeatures DetectCPUFeatures()
+{
+    CPUFeatures features;
+
+    int registers[4];
+    CPUID(0, 0, registers);
+    int max_leaf = registers[0];
+
+    char vendor[13] = { 0 };
+    memcpy(vendor, &registers[1], 4);
+    memcpy(vendor + 4, &registers[3], 4);
+    memcpy(vendor + 8, &registers[2], 4);
+
+    if (max_leaf < 7)
+    {
+        return features;
+    }
+
+    CPUID(1, 0, registers);
+    bool osxsave = (registers[2] >> 27) & 0x01;
+    bool avx = (registers[2] >> 28) & 0x01;
+
+    uint32_t family = (registers[0] >> 8) & 0x0F;
+    if (family == 0x0F)
+    {
+        family += (registers[0] >> 20) & 0xFF;
+    }
+
+    CPUID(7, 0, registers);
+    bool avx2 = (registers[1] >> 5) & 0x01;
+    bool bmi2 = (registers[1] >> 8) & 0x01;
+
+    // the os has to save the ymm registers too
+    features.avx2 = avx2 && avx && osxsave && (ReadXCR0() & 0x06) == 0x06;
+
+    // pdep is microcoded and very slow on AMD before Zen 3
+    features.fast_bmi2 = bmi2 && !(strcmp(vendor, "AuthenticAMD") == 0 && family < 0x19);
+
+    return features;
+}
+
+#endif
+
+static const PixelKernels scalar_kernels = {
+    "scalar",
+    DecodeTileRowScalar,
+    DecodeTileRowsScalar,
+    MapPaletteScalar,
+    ExpandShades8Scalar,
+    ExpandShades16Scalar,
+    ExpandShades32Scalar
+};
+
+const PixelKernels* FindPixelKernels(const char* name)
+{
+    if (strcmp(name, "scalar") == 0)
+    {
+        return &scalar_kernels;
+    }
+
+#ifdef PIXEL_KERNELS_X86
+    static const PixelKernels sse2_kernels = {
+        "sse2",
+        DecodeTileRowSSE2,
+        DecodeTileRowsSSE2,
+        MapPaletteSSE2,
+        ExpandShades8SSE2,
+        ExpandShades16SSE2,
+        ExpandShades32SSE2
+    };
+    static const CPUFeatures features = DetectCPUFeatures();
+    static const PixelKernels avx2_kernels = {
+        "avx2",
+        features.fast_bmi2 ? DecodeTileRowBMI2 : DecodeTileRowSSE2,
+        DecodeTileRowsAVX2,
+        MapPaletteAVX2,
+        ExpandShades8AVX2,
+        ExpandShades16AVX2,
+        ExpandShades32AVX2
+    };
+
+    if (strcmp(name, "sse2") == 0)
+    {
+        return &sse2_kernels;
+    }
+
+    if (strcmp(name, "avx2") == 0 && features.avx2)
+    {
+        return &avx2_kernels;
+    }
+#endif
+
+    return nullptr;
+}
+
+const PixelKernels& GetPixelKernels()
+{
+    static const PixelKernels* kernels = nullptr;
+
+    if (kernels == nullptr)
+    {
+        static const char* preferred[] = { "avx2", "sse2", "scalar" };
+        for (const char* name : preferred)
+        {
+            kernels = FindPixelKernels(name);
+            if (kernels != nullptr)
+            {
+                break;
+            }
+        }
+    }
+
+    return *kernels;
+}
+
+const uint32_t dmg_screen_colors[4] = { 0xE8FCCC, 0xACD490, 0x548C70, 0x1E2C38 };
+
+void ConvertShades(const uint8_t* shades, uint32_t count, ScreenFormat format, const uint32_t* colors, void* out)
+{
+    const PixelKernels& kernels = GetPixelKernels();
+
+    switch (format)
+    {
+    case SCREEN_FORMAT_RGBA8888:
+    {
+        uint32_t lut[4];
+        for (int i = 0; i < 4; i++)
+        {
+            // byte order instead of a packed value so the layout doesn't depend on endianness
+            uint8_t rgba[4] = { (uint8_t)(colors[i] >> 16), (uint8_t)(colors[i] >> 8), (uint8_t)colors[i], 0xFF };
+            memcpy(&lut[i], rgba, sizeof(rgba));
+        }
+
+        kernels.expand_shades_32(shades, lut, (uint32_t*)out, count);
+        break;
+    }
+    case SCREEN_FORMAT_RGB565:
+    {
+        uint16_t lut[4];
+        for (int i = 0; i < 4; i++)
+        {
+            uint8_t r = colors[i] >> 16;
+            uint8_t g = colors[i] >> 8;
+            uint8_t b = colors[i];
+            lut[i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        }
+
+        kernels.expand_shades_16(shades, lut, (uint16_t*)out, count);
+        break;
+    }
+    case SCREEN_FORMAT_GRAY8:
+    {
+        uint8_t lut[4];
+        for (int i = 0; i < 4; i++)
+        {
+            uint8_t r = colors[i] >> 16;
+            uint8_t g = colors[i] >> 8;
+            uint8_t b = colors[i];
+            lut[i] = (r * 77 + g * 150 + b * 29) >> 8;
+        }
+
+        kernels.expand_shades_8(shades, lut, (uint8_t*)out, count);
+        break;
+    }
+    }
+}
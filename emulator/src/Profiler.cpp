@@ -0,0 +1,454 @@
+#include "Profiler.h"
+#include "GameBoy.h"
+
+#include <algorithm>
+
+#define PROFILER_MAX_DEPTH 64
+#define PROFILER_ROOT_FUNCTION 0xFFFFFFFF
+#define PROFILER_BOOTROM_BANK 0xFFFF
+
+// counters after the rom: 0x8000-0xFFFF, then the 256 byte bootrom
+#define PROFILER_RAM_COUNTERS 0x8000
+#define PROFILER_BOOTROM_COUNTERS 0x100
+
+Profiler::Profiler(GameBoy* gameboy)
+{
+	this->gb = gameboy;
+	this->Reset();
+}
+
+Profiler::~Profiler()
+{
+
+}
+
+void Profiler::Reset()
+{
+	this->rom_size = 0;
+	if (this->gb->active_cartridge != nullptr)
+	{
+		this->rom_size = this->gb->active_cartridge->GetROMBankCount() * 0x4000;
+	}
+
+	// only allocated while profiling, large roms need a lot of counters
+	this->counters.clear();
+	if (this->enabled)
+	{
+		this->counters.assign(this->rom_size + PROFILER_RAM_COUNTERS + PROFILER_BOOTROM_COUNTERS, 0);
+	}
+
+	this->nodes.clear();
+	this->nodes.push_back({ PROFILER_ROOT_FUNCTION, 0, 0 });
+	this->children.clear();
+	this->frames.clear();
+	this->current_node = 0;
+
+	this->total_cycles = 0;
+	this->sample_countdown = this->sample_period;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	this->enabled = enabled;
+
+	if (enabled && this->counters.empty())
+	{
+		this->counters.assign(this->rom_size + PROFILER_RAM_COUNTERS + PROFILER_BOOTROM_COUNTERS, 0);
+	}
+
+	// the call stack at this point is unknown, start over from the root
+	this->frames.clear();
+	this->current_node = 0;
+}
+
+void Profiler::SetMode(ProfilerMode mode, uint32_t sample_period)
+{
+	this->mode = mode;
+	this->sample_period = std::max(sample_period, 1u);
+	this->sample_countdown = this->sample_period;
+}
+
+uint16_t Profiler::GetBank(uint16_t address)
+{
+	if (address < 0x100 && this->gb->IsBootromMapped())
+	{
+		return PROFILER_BOOTROM_BANK;
+	}
+
+	if (address >= 0x4000 && address <= 0x7FFF && this->gb->active_cartridge != nullptr)
+	{
+		return this->gb->active_cartridge->GetROMBank();
+	}
+
+	return 0;
+}
+
+uint32_t Profiler::GetCounterIndex(uint16_t address)
+{
+	if (address < 0x100 && this->gb->IsBootromMapped())
+	{
+		return this->rom_size + PROFILER_RAM_COUNTERS + address;
+	}
+
+	if (address <= 0x7FFF)
+	{
+		uint32_t offset = address;
+		if (address >= 0x4000)
+		{
+			offset = this->GetBank(address) * 0x4000 + (address - 0x4000);
+		}
+
+		return (this->rom_size > 0) ? offset % this->rom_size : 0;
+	}
+
+	return this->rom_size + (address - 0x8000);
+}
+
+void Profiler::OnInstruction(uint16_t pc, uint16_t sp, uint32_t cycles)
+{
+	this->total_cycles += cycles;
+
+	uint64_t amount = cycles;
+	if (this->mode == PROFILE_SAMPLED)
+	{
+		this->sample_countdown -= cycles;
+
+		amount = 0;
+		while (this->sample_countdown <= 0)
+		{
+			this->sample_countdown += this->sample_period;
+			amount += this->sample_period;
+		}
+	}
+
+	if (amount > 0)
+	{
+		this->counters[this->GetCounterIndex(pc)] += amount;
+		this->nodes[this->current_node].cycles += amount;
+	}
+
+	uint16_t new_sp = this->gb->cpu->registers.SP;
+
+	// a frame ends once its return address has been popped, no matter which instruction did it
+	while (!this->frames.empty() && new_sp > this->frames.back().sp)
+	{
+		this->frames.pop_back();
+		this->current_node = this->frames.empty() ? 0 : this->frames.back().node;
+	}
+
+	// a taken CALL or RST pushed exactly one return address
+	if (new_sp == (uint16_t)(sp - 2))
+	{
+		uint8_t opcode = this->gb->mmu->Peek(pc);
+
+		bool call = opcode == 0xCD // CALL a16
+			|| (opcode & 0xE7) == 0xC4 // CALL cc, a16
+			|| (opcode & 0xC7) == 0xC7; // RST
+
+		if (call)
+		{
+			this->EnterFunction(this->gb->cpu->registers.PC, new_sp);
+		}
+	}
+}
+
+void Profiler::OnInterrupt(uint16_t vector)
+{
+	this->EnterFunction(vector, this->gb->cpu->registers.SP);
+}
+
+void Profiler::EnterFunction(uint16_t address, uint16_t sp)
+{
+	// deeper calls are attributed to the caller, their returns leave the outer frames alone
+	if (this->frames.size() >= PROFILER_MAX_DEPTH)
+	{
+		return;
+	}
+
+	uint32_t function = (this->GetBank(address) << 16) | address;
+	uint64_t key = ((uint64_t)this->current_node << 32) | function;
+
+	uint32_t node;
+	auto it = this->children.find(key);
+	if (it == this->children.end())
+	{
+		node = (uint32_t)this->nodes.size();
+		this->nodes.push_back({ function, this->current_node, 0 });
+		this->children[key] = node;
+	}
+	else
+	{
+		node = it->second;
+	}
+
+	this->frames.push_back({ node, sp });
+	this->current_node = node;
+}
+
+static void FormatLocation(uint16_t bank, uint16_t address, char* buffer, size_t size)
+{
+	if (bank == PROFILER_BOOTROM_BANK)
+	{
+		snprintf(buffer, size, "BOOT:%04X", address);
+	}
+	else if (address <= 0x7FFF)
+	{
+		snprintf(buffer, size, "%02X:%04X", bank, address);
+	}
+	else
+	{
+		snprintf(buffer, size, "%04X", address);
+	}
+}
+
+std::vector<ProfileEntry> Profiler::GetTopInstructions(size_t count)
+{
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < this->counters.size(); i++)
+	{
+		if (this->counters[i] > 0)
+		{
+			indices.push_back(i);
+		}
+	}
+
+	count = std::min(count, indices.size());
+	std::partial_sort(indices.begin(), indices.begin() + count, indices.end(),
+		[this](uint32_t a, uint32_t b) { return this->counters[a] > this->counters[b]; });
+
+	std::vector<ProfileEntry> entries;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t index = indices[i];
+
+		ProfileEntry entry;
+		entry.cycles = this->counters[index];
+		entry.total_cycles = entry.cycles;
+
+		char location[16];
+		if (index < this->rom_size)
+		{
+			uint16_t bank = index / 0x4000;
+			uint16_t address = (bank == 0) ? index : 0x4000 + (index % 0x4000);
+
+			FormatLocation(bank, address, location, sizeof(location));
+			entry.symbol = this->GetSymbolName(bank, address);
+		}
+		else if (index < this->rom_size + PROFILER_RAM_COUNTERS)
+		{
+			uint16_t address = 0x8000 + (index - this->rom_size);
+
+			FormatLocation(0, address, location, sizeof(location));
+			entry.symbol = this->GetSymbolName(0, address);
+		}
+		else
+		{
+			FormatLocation(PROFILER_BOOTROM_BANK, index - this->rom_size - PROFILER_RAM_COUNTERS, location, sizeof(location));
+		}
+
+		entry.location = location;
+		entries.push_back(entry);
+	}
+
+	return entries;
+}
+
+std::vector<ProfileEntry> Profiler::GetTopFunctions(size_t count)
+{
+	std::unordered_map<uint32_t, ProfileEntry> functions;
+	std::vector<uint32_t> path;
+
+	for (uint32_t i = 0; i < this->nodes.size(); i++)
+	{
+		const CallNode& node = this->nodes[i];
+		if (node.cycles == 0)
+		{
+			continue;
+		}
+
+		functions[node.function].cycles += node.cycles;
+
+		// every distinct function on the stack includes these cycles, recursion counts once
+		path.clear();
+		uint32_t n = i;
+		while (true)
+		{
+			uint32_t function = this->nodes[n].function;
+			if (std::find(path.begin(), path.end(), function) == path.end())
+			{
+				path.push_back(function);
+				functions[function].total_cycles += node.cycles;
+			}
+
+			if (n == 0)
+			{
+				break;
+			}
+
+			n = this->nodes[n].parent;
+		}
+	}
+
+	std::vector<ProfileEntry> entries;
+	for (auto& it : functions)
+	{
+		ProfileEntry& entry = it.second;
+		if (it.first == PROFILER_ROOT_FUNCTION)
+		{
+			entry.location = "-";
+			entry.symbol = "(root)";
+		}
+		else
+		{
+			char location[16];
+			FormatLocation(it.first >> 16, it.first & 0xFFFF, location, sizeof(location));
+			entry.location = location;
+			entry.symbol = this->GetSymbolName(it.first >> 16, it.first & 0xFFFF);
+		}
+
+		entries.push_back(entry);
+	}
+
+	count = std::min(count, entries.size());
+	std::partial_sort(entries.begin(), entries.begin() + count, entries.end(),
+		[](const ProfileEntry& a, const ProfileEntry& b) { return a.cycles > b.cycles; });
+	entries.resize(count);
+
+	return entries;
+}
+
+bool Profiler::LoadSymbols(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open symbol file: " << path << std::endl;
+		return false;
+	}
+
+	this->symbols.clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		size_t comment = line.find(';');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		unsigned int bank = 0;
+		unsigned int address = 0;
+		char name[256];
+
+		if (sscanf(line.c_str(), "%x:%x %255s", &bank, &address, name) == 3 && bank <= 0xFFFF && address <= 0xFFFF)
+		{
+			this->symbols[(bank << 16) | address] = name;
+		}
+	}
+
+	return true;
+}
+
+// Memory regions a symbol offset may not cross
+static int GetSymbolRegion(uint16_t address)
+{
+	if (address <= 0x7FFF)
+	{
+		return address >> 14;
+	}
+
+	if (address <= 0xDFFF)
+	{
+		return address >> 13;
+	}
+
+	return 7;
+}
+
+std::string Profiler::GetSymbolName(uint16_t bank, uint16_t address)
+{
+	uint32_t key = (bank << 16) | address;
+
+	auto it = this->symbols.upper_bound(key);
+	if (it == this->symbols.begin())
+	{
+		return "";
+	}
+
+	--it;
+
+	uint16_t symbol_address = it->first & 0xFFFF;
+	if ((it->first >> 16) != bank || GetSymbolRegion(symbol_address) != GetSymbolRegion(address))
+	{
+		return "";
+	}
+
+	if (symbol_address == address)
+	{
+		return it->second;
+	}
+
+	char offset[8];
+	snprintf(offset, sizeof(offset), "+$%X", address - symbol_address);
+	return it->second + offset;
+}
+
+std::string Profiler::GetFunctionName(uint32_t function)
+{
+	if (function == PROFILER_ROOT_FUNCTION)
+	{
+		return "root";
+	}
+
+	std::string name = this->GetSymbolName(function >> 16, function & 0xFFFF);
+	if (!name.empty())
+	{
+		return name;
+	}
+
+	char location[16];
+	FormatLocation(function >> 16, function & 0xFFFF, location, sizeof(location));
+	return location;
+}
+
+bool Profiler::ExportCollapsedStacks(const std::string& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not write profile: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> names(this->nodes.size());
+	for (uint32_t i = 0; i < this->nodes.size(); i++)
+	{
+		names[i] = this->GetFunctionName(this->nodes[i].function);
+	}
+
+	std::vector<uint32_t> stack;
+	for (uint32_t i = 0; i < this->nodes.size(); i++)
+	{
+		if (this->nodes[i].cycles == 0)
+		{
+			continue;
+		}
+
+		stack.clear();
+		for (uint32_t n = i; n != 0; n = this->nodes[n].parent)
+		{
+			stack.push_back(n);
+		}
+		stack.push_back(0);
+
+		for (size_t s = stack.size(); s > 0; s--)
+		{
+			file << names[stack[s - 1]] << ((s > 1) ? ";" : " ");
+		}
+
+		file << this->nodes[i].cycles << "\n";
+	}
+
+	return file.good();
+}
@@ -0,0 +1,212 @@
+#include "RealTimeClock.h"
+
+#include <chrono>
+
+#define RTC_CYCLES_PER_SECOND 1048576 // M-cycles
+#define RTC_DAY_SECONDS 86400
+#define RTC_COUNTER_LIMIT (512ull * RTC_DAY_SECONDS) // the day counter has 9 bits
+
+static uint64_t GetHostMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void WriteValue(std::ostream& file, uint64_t value, int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		file.put((char)(value >> (i * 8)));
+	}
+}
+
+static uint64_t ReadValue(const uint8_t* data, int size)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < size; i++)
+	{
+		value |= (uint64_t)data[i] << (i * 8);
+	}
+
+	return value;
+}
+
+RealTimeClock::RealTimeClock()
+{
+
+}
+
+void RealTimeClock::SetClock(RTCClock clock, const uint64_t* cycle_counter)
+{
+	// the seconds so far are kept, only the source of the new ones changes
+	this->Rebase();
+
+	this->clock = clock;
+	this->cycle_counter = cycle_counter;
+	this->base_ticks = this->GetTicks();
+}
+
+uint64_t RealTimeClock::GetTicks()
+{
+	if (this->clock == RTC_CLOCK_HOST)
+	{
+		return GetHostMicroseconds();
+	}
+
+	return (this->cycle_counter != nullptr) ? *this->cycle_counter : 0;
+}
+
+uint64_t RealTimeClock::GetTicksPerSecond()
+{
+	return (this->clock == RTC_CLOCK_HOST) ? 1000000 : RTC_CYCLES_PER_SECOND;
+}
+
+void RealTimeClock::Rebase()
+{
+	if (!this->halted)
+	{
+		uint64_t now = this->GetTicks();
+
+		// the host clock can be set back
+		if (now < this->base_ticks)
+		{
+			this->base_ticks = now;
+		}
+
+		// the fraction of a second stays in base_ticks
+		uint64_t seconds = (now - this->base_ticks) / this->GetTicksPerSecond();
+		this->base_seconds += seconds;
+		this->base_ticks += seconds * this->GetTicksPerSecond();
+	}
+
+	if (this->base_seconds >= RTC_COUNTER_LIMIT)
+	{
+		this->carry = true;
+		this->base_seconds %= RTC_COUNTER_LIMIT;
+	}
+}
+
+void RealTimeClock::GetRegisters(uint64_t seconds, uint8_t* registers)
+{
+	uint16_t days = (uint16_t)(seconds / RTC_DAY_SECONDS);
+
+	registers[0] = seconds % 60;
+	registers[1] = (seconds / 60) % 60;
+	registers[2] = (seconds / 3600) % 24;
+	registers[3] = days & 0xFF;
+	registers[4] = ((days >> 8) & 0x01) | (this->halted ? 0x40 : 0) | (this->carry ? 0x80 : 0);
+}
+
+void RealTimeClock::Latch()
+{
+	this->Rebase();
+	this->GetRegisters(this->base_seconds, this->latched);
+}
+
+uint8_t RealTimeClock::ReadRegister(uint8_t reg)
+{
+	if (reg < RTC_SECONDS || reg > RTC_DAY_HIGH)
+	{
+		return 0xFF;
+	}
+
+	return this->latched[reg - RTC_SECONDS];
+}
+
+void RealTimeClock::WriteRegister(uint8_t reg, uint8_t value)
+{
+	this->Rebase();
+
+	uint8_t registers[5];
+	this->GetRegisters(this->base_seconds, registers);
+
+	switch (reg)
+	{
+	case RTC_SECONDS:
+		registers[0] = value % 60;
+
+		// restarts the current second
+		this->base_ticks = this->GetTicks();
+		break;
+	case RTC_MINUTES: registers[1] = value % 60; break;
+	case RTC_HOURS: registers[2] = value % 24; break;
+	case RTC_DAY_LOW: registers[3] = value; break;
+	case RTC_DAY_HIGH:
+	{
+		registers[4] = value;
+		this->carry = (value & 0x80) != 0;
+
+		bool halted = (value & 0x40) != 0;
+		if (this->halted && !halted)
+		{
+			// counts from now on, the time spent halted is not added
+			this->base_ticks = this->GetTicks();
+		}
+
+		this->halted = halted;
+		break;
+	}
+	default:
+		return;
+	}
+
+	uint16_t days = registers[3] | ((registers[4] & 0x01) << 8);
+	this->base_seconds = registers[0] + registers[1] * 60 + registers[2] * 3600 + (uint64_t)days * RTC_DAY_SECONDS;
+}
+
+void RealTimeClock::Save(std::ostream& file)
+{
+	this->Rebase();
+
+	uint8_t registers[5];
+	this->GetRegisters(this->base_seconds, registers);
+
+	for (int i = 0; i < 5; i++)
+	{
+		WriteValue(file, registers[i], 4);
+	}
+
+	for (int i = 0; i < 5; i++)
+	{
+		WriteValue(file, this->latched[i], 4);
+	}
+
+	WriteValue(file, GetHostMicroseconds() / 1000000, 8);
+}
+
+bool RealTimeClock::Load(std::istream& file, size_t size)
+{
+	if (size != RTC_SAVE_SIZE && size != RTC_SAVE_SIZE - 4)
+	{
+		return false;
+	}
+
+	uint8_t data[RTC_SAVE_SIZE];
+	if (!file.read((char*)data, size))
+	{
+		return false;
+	}
+
+	uint8_t registers[5];
+	for (int i = 0; i < 5; i++)
+	{
+		registers[i] = (uint8_t)ReadValue(&data[i * 4], 4);
+		this->latched[i] = (uint8_t)ReadValue(&data[20 + i * 4], 4);
+	}
+
+	uint16_t days = registers[3] | ((registers[4] & 0x01) << 8);
+	this->base_seconds = (registers[0] % 60) + (registers[1] % 60) * 60 + (registers[2] % 24) * 3600 + (uint64_t)days * RTC_DAY_SECONDS;
+	this->halted = (registers[4] & 0x40) != 0;
+	this->carry = (registers[4] & 0x80) != 0;
+	this->base_ticks = this->GetTicks();
+
+	// the host clock kept running while the emulator was closed
+	uint64_t saved_time = ReadValue(&data[40], (int)size - 40);
+	uint64_t now = GetHostMicroseconds() / 1000000;
+	if (this->clock == RTC_CLOCK_HOST && !this->halted && now > saved_time)
+	{
+		this->base_seconds += now - saved_time;
+	}
+
+	this->Rebase();
+	return true;
+}
@@ -0,0 +1,162 @@
+#include "RenderThread.h"
+
+#define RENDER_THREAD_IDLE_SPINS 256 // yields before the worker sleeps
+
+RenderThread::RenderThread(const VideoMemory& memory)
+{
+    this->kernels = &GetPixelKernels();
+    this->memory = memory;
+
+    this->worker = std::thread(&RenderThread::Run, this);
+}
+
+RenderThread::~RenderThread()
+{
+    this->WaitIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+
+    this->wake_condition.notify_one();
+    this->worker.join();
+}
+
+void RenderThread::QueueVRAMWrite(uint16_t offset, uint8_t data)
+{
+    uint32_t tail = this->write_tail.load(std::memory_order_relaxed);
+
+    // full, the worker applies writes even while no lines are queued
+    while (tail - this->write_head.load(std::memory_order_acquire) == RENDER_THREAD_WRITE_COUNT)
+    {
+        this->Wake();
+        std::this_thread::yield();
+    }
+
+    this->writes[tail & (RENDER_THREAD_WRITE_COUNT - 1)] = { offset, data };
+    this->write_tail.store(tail + 1, std::memory_order_seq_cst);
+
+    // lines apply the writes before them anyway, the worker is only woken for writes in bulk
+    if (tail + 1 - this->write_head.load(std::memory_order_relaxed) >= RENDER_THREAD_WRITE_COUNT / 2)
+    {
+        this->Wake();
+    }
+}
+
+void RenderThread::QueueLine(const ScanlineJob& job, uint8_t* line)
+{
+    uint32_t tail = this->line_tail.load(std::memory_order_relaxed);
+
+    while (tail - this->line_head.load(std::memory_order_acquire) == RENDER_THREAD_JOB_COUNT)
+    {
+        std::this_thread::yield();
+    }
+
+    LineSlot& slot = this->lines[tail & (RENDER_THREAD_JOB_COUNT - 1)];
+    slot.job = job;
+    slot.line = line;
+    slot.write_end = this->write_tail.load(std::memory_order_relaxed);
+
+    this->line_tail.store(tail + 1, std::memory_order_seq_cst);
+
+    this->Wake();
+}
+
+void RenderThread::WaitIdle()
+{
+    this->Wake();
+
+    while (this->line_head.load(std::memory_order_acquire) != this->line_tail.load(std::memory_order_relaxed)
+        || this->write_head.load(std::memory_order_acquire) != this->write_tail.load(std::memory_order_relaxed))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void RenderThread::SyncVideoMemory(const VideoMemory& memory)
+{
+    this->memory = memory;
+}
+
+void RenderThread::Wake()
+{
+    // paired with the sleeping store in Run, either the worker sees the new tail or this sees it asleep
+    if (this->sleeping.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->wake_condition.notify_one();
+    }
+}
+
+void RenderThread::ApplyWrites(uint32_t end)
+{
+    // end never lies behind head, the signed distance only guards against draining past it
+    uint32_t head = this->write_head.load(std::memory_order_relaxed);
+    while ((int32_t)(end - head) > 0)
+    {
+        const VRAMWrite& write = this->writes[head & (RENDER_THREAD_WRITE_COUNT - 1)];
+        this->memory.Write(write.offset, write.data);
+        head++;
+    }
+
+    this->write_head.store(head, std::memory_order_release);
+}
+
+void RenderThread::Run()
+{
+    uint32_t idle_spins = 0;
+
+    while (true)
+    {
+        // the write tail is read before the line tail: every line queued before these writes is
+        // visible below, and a line queued after them has a write_end at or past write_end
+        uint32_t write_end = this->write_tail.load(std::memory_order_acquire);
+
+        uint32_t head = this->line_head.load(std::memory_order_relaxed);
+        if (head != this->line_tail.load(std::memory_order_acquire))
+        {
+            const LineSlot& slot = this->lines[head & (RENDER_THREAD_JOB_COUNT - 1)];
+
+            this->ApplyWrites(slot.write_end);
+            RenderScanline(this->memory, slot.job, *this->kernels, slot.line);
+
+            this->line_head.store(head + 1, std::memory_order_release);
+            idle_spins = 0;
+            continue;
+        }
+
+        // keeps the write queue from filling up while the lcd is off
+        if (this->write_head.load(std::memory_order_relaxed) != write_end)
+        {
+            this->ApplyWrites(write_end);
+            continue;
+        }
+
+        // lines come every few microseconds while the emulation runs, sleeping between them costs more
+        if (idle_spins < RENDER_THREAD_IDLE_SPINS)
+        {
+            idle_spins++;
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->sleeping.store(true, std::memory_order_seq_cst);
+
+        this->wake_condition.wait(lock, [this]()
+        {
+            return this->stop
+                || this->line_head.load(std::memory_order_relaxed) != this->line_tail.load(std::memory_order_seq_cst)
+                || this->write_head.load(std::memory_order_relaxed) != this->write_tail.load(std::memory_order_seq_cst);
+        });
+
+        this->sleeping.store(false, std::memory_order_relaxed);
+        idle_spins = 0;
+
+        if (this->stop)
+        {
+            break;
+        }
+    }
+}
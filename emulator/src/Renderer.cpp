@@ -16,7 +16,7 @@ const char* screenFragmentShader = "#version 430 core\n"
 "void main() {\n"
 "   ivec2 pixelPos = ivec2(floor(uv * vec2(160, 144)));\n"
 "   int id = 160 * (143 - pixelPos.y) + pixelPos.x;\n"
-"   uint pixelId = pixels[id];\n"
+"   uint pixelId = (pixels[id / 4] >> ((id % 4) * 8)) & 0xFFu;\n"
 "   if(pixelId == 0) {outColor = vec4(232.0/255.0, 252.0/255.0, 204.0/255.0, 1.0);}\n"
 "   else if(pixelId == 1) {outColor = vec4(172.0/255.0, 212.0/255.0, 144.0/255.0, 1.0);}\n"
 "   else if(pixelId == 2) {outColor = vec4(84.0/255.0, 140.0/255.0, 112.0/255.0, 1.0);}\n"
@@ -53,7 +53,8 @@ Renderer::Renderer()
     glGenBuffers(1, &this->screen_buffer);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->screen_buffer);
 
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 160 * 144 * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    // one byte per pixel, the shader unpacks four from each uint
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 160 * 144 * sizeof(uint8_t), nullptr, GL_DYNAMIC_DRAW);
 
     // Setup vram debug textures
 
@@ -152,44 +153,56 @@ void Renderer::Render(GameBoy* gb)
     glUseProgram(this->screen_shader);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->screen_buffer);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 160 * 144 * sizeof(uint32_t), gb->ppu->screen_pixels);
+
+    // only completed frames are shown, upload each one once
+    uint64_t frame = gb->GetFrameCount();
+    if (frame != this->uploaded_frame)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, 160 * 144 * sizeof(uint8_t), gb->GetFrame());
+        this->uploaded_frame = frame;
+    }
+
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->screen_buffer);
 
     glBindVertexArray(this->vao);
     glDrawArrays(GL_TRIANGLES, 0, 3);
 }
 
+// inverts the color ids so color 0 shows as white
+#define DEBUG_GRAY_PALETTE 0x1B
+static const uint8_t debug_gray_levels[4] = { 0, 85, 170, 255 };
+
 static uint8_t tile_debug_buffer[3 * 128 * 192];
 static uint8_t bg_debug_buffer[3 * 256 * 256];
 static uint8_t sprite_debug_buffer[3 * 256 * 256];
 void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 {
+    const PixelKernels& kernels = GetPixelKernels();
+
+    gb->ppu->FlushTileCache();
+
     if (info.render_tiles)
     {
         for (uint32_t i = 0; i < 384; i++)
         {
-            uint32_t address = 0x8000 + i * 0x10;
+            uint16_t tile_offset = i * 0x10;
             uint16_t tile_x = 8 * (i % 16);
             uint16_t tile_y = 8 * (i / 16);
 
             for (uint8_t y = 0; y < 8; y++)
             {
-                uint8_t b0 = gb->mmu->Read(address + y * 2);
-                uint8_t b1 = gb->mmu->Read(address + 1 + y * 2);
+                uint8_t shades[8];
+                kernels.map_palette(gb->ppu->GetTileRow(tile_offset + y * 2, false), DEBUG_GRAY_PALETTE, shades, 8);
 
                 for (uint8_t x = 0; x < 8; x++)
                 {
-                    uint8_t color = (GET_BIT(b1, 7 - x) << 1) | (GET_BIT(b0, 7 - x));
-
                     uint16_t pixel_pos_x = tile_x + x;
                     uint16_t pixel_pos_y = tile_y + y;
                     uint32_t id = (pixel_pos_x + pixel_pos_y * 128) * 3;
 
-                    color = 3 - color;
-
-                    tile_debug_buffer[id] = (uint8_t)(((float)color / 3.0f) * 255);
-                    tile_debug_buffer[id + 1] = (uint8_t)(((float)color / 3.0f) * 255);
-                    tile_debug_buffer[id + 2] = (uint8_t)(((float)color / 3.0f) * 255);
+                    tile_debug_buffer[id] = debug_gray_levels[shades[x]];
+                    tile_debug_buffer[id + 1] = debug_gray_levels[shades[x]];
+                    tile_debug_buffer[id + 2] = debug_gray_levels[shades[x]];
                 }
             }
         }
@@ -200,8 +213,11 @@ void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 
     if (info.render_bg)
     {
-        uint8_t scy = gb->mmu->Read(0xFF42);
-        uint8_t scx = gb->mmu->Read(0xFF43);
+        uint8_t scy = gb->mmu->Peek(0xFF42);
+        uint8_t scx = gb->mmu->Peek(0xFF43);
+
+        MemorySpan vram = gb->mmu->GetSpan(MEMORY_REGION_VRAM);
+        const uint8_t* tile_map = &vram.data[(info.map_use_window_address ? 0x9C00 : 0x9800) - vram.address];
 
         uint8_t scroll_min_corner_x = scx % 256;
         uint8_t scroll_max_corner_x = (scroll_min_corner_x + 159) % 256;
@@ -211,23 +227,22 @@ void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 
         for (uint32_t i = 0; i < 1024; i++)
         {
-            uint32_t address = (info.map_use_window_address ? 0x9C00 : 0x9800) + i;
-            uint8_t tile = gb->mmu->Read(address);
-            uint16_t tile_address = 0;
+            uint8_t tile = tile_map[i];
+            uint16_t tile_offset = 0;
 
             if (info.map_use_8000_tile_address)
             {
-                tile_address = 0x8000 + tile * 0x10;
+                tile_offset = tile * 0x10;
             }
             else
             {
                 if (tile >= 128 && tile < 256)
                 {
-                    tile_address = (0x8800 + (tile - 128) * 0x10);
+                    tile_offset = (0x0800 + (tile - 128) * 0x10);
                 }
                 else
                 {
-                    tile_address = (0x9000 + tile * 0x10);
+                    tile_offset = (0x1000 + tile * 0x10);
                 }
             }
 
@@ -236,12 +251,11 @@ void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 
             for (uint8_t y = 0; y < 8; y++)
             {
-                uint8_t b0 = gb->mmu->Read(tile_address + y * 2);
-                uint8_t b1 = gb->mmu->Read(tile_address + 1 + y * 2);
+                const uint8_t* tile_row = gb->ppu->GetTileRow(tile_offset + y * 2, false);
 
                 for (uint8_t x = 0; x < 8; x++)
                 {
-                    uint8_t color = (GET_BIT(b1, 7 - x) << 1) | (GET_BIT(b0, 7 - x));
+                    uint8_t color = tile_row[x];
 
                     uint16_t pixel_pos_x = tile_x + x;
                     uint16_t pixel_pos_y = tile_y + y;
@@ -318,7 +332,8 @@ void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 
     if (info.render_oam)
     {
-        uint8_t lcd_control = gb->mmu->Read(0xFF40);
+        uint8_t lcd_control = gb->mmu->Peek(0xFF40);
+        MemorySpan oam = gb->mmu->GetSpan(MEMORY_REGION_OAM);
         uint8_t sprite_height = (lcd_control & 0x04) ? 16 : 8;
         /*
         for (int i = 0; i < 40; i++)
@@ -358,35 +373,31 @@ void Renderer::RenderVRAMDebug(GameBoy* gb, VRAMDebugInfo& info)
 
         for (uint32_t i = 0; i < 40; i++)
         {
-            uint32_t address = 0xFE00 + 2 + i * 4;
-            uint8_t tile = gb->mmu->Read(address);
+            uint8_t tile = oam.data[i * 4 + 2];
 
             if(sprite_height == 16)
                 CLEAR_BIT(tile, 0);
             
-            uint16_t tile_address = 0x8000 + tile * 0x10;
+            uint16_t tile_offset = tile * 0x10;
 
             for (uint8_t y = 0; y < sprite_height; y++)
             {
                 if (y == 8)
                 {
                     SET_BIT(tile, 0);
-                    tile_address = 0x8000 + tile * 0x10;
+                    tile_offset = tile * 0x10;
                 }
 
-                uint8_t b0 = gb->mmu->Read(tile_address + (y % 8) * 2);
-                uint8_t b1 = gb->mmu->Read(tile_address + 1 + (y % 8) * 2);
+                uint8_t shades[8];
+                kernels.map_palette(gb->ppu->GetTileRow(tile_offset + (y % 8) * 2, false), DEBUG_GRAY_PALETTE, shades, 8);
 
                 for (uint8_t x = 0; x < 8; x++)
                 {
-                    uint8_t color = (GET_BIT(b1, 7 - x) << 1) | (GET_BIT(b0, 7 - x));
                     uint32_t id = (x + y * 8) * 3;
 
-                    color = 3 - color;
-
-                    sprite_debug_buffer[id] = (uint8_t)(((float)color / 3.0f) * 255);
-                    sprite_debug_buffer[id + 1] = (uint8_t)(((float)color / 3.0f) * 255);
-                    sprite_debug_buffer[id + 2] = (uint8_t)(((float)color / 3.0f) * 255);
+                    sprite_debug_buffer[id] = debug_gray_levels[shades[x]];
+                    sprite_debug_buffer[id + 1] = debug_gray_levels[shades[x]];
+                    sprite_debug_buffer[id + 2] = debug_gray_levels[shades[x]];
 
                     if (tile == 0)
                     {
@@ -0,0 +1,129 @@
+#include "ScanlineRenderer.h"
+#include "BitwiseUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+void RenderScanline(VideoMemory& memory, const ScanlineJob& job, const PixelKernels& kernels, uint8_t* line)
+{
+    uint8_t ly = job.ly;
+    const uint8_t* vram = memory.GetData();
+
+    memory.FlushTileCache();
+
+    // color ids, 8 spare entries on each side so whole tile rows can be copied past the edges
+    uint8_t ids[8 + 160 + 8];
+    uint8_t tiles[8 + 160 + 8];
+
+    // x of the first window pixel, a WX below 7 cuts off the left side of the window
+    int window_left = 160;
+    bool window_active = false;
+
+    // each segment is drawn with the registers written before it, see PPU::LogRegisterWrite
+    for (uint8_t s = 0; s < job.segment_count; s++)
+    {
+        const ScanlineRegisters& r = job.segments[s].registers;
+        int x0 = job.segments[s].x;
+        int x1 = (s + 1 < job.segment_count) ? job.segments[s + 1].x : 160;
+
+        // the window starts when x reaches WX - 7 and ends if LCDC.5 is cleared
+        if (!GET_BIT(r.lcdc, 5))
+        {
+            window_active = false;
+        }
+        else if (!window_active && job.window_reached && r.wx - 7 < x1 && (r.wx - 7 >= x0 || s == 0))
+        {
+            window_left = r.wx - 7;
+            window_active = true;
+        }
+
+        int window_start = window_active ? std::max(window_left, x0) : x1;
+
+        bool unsigned_tiles = GET_BIT(r.lcdc, 4);
+
+        // whole tile rows around the segment, only the segment itself is copied to the line
+        uint8_t bg_y = ly + r.scy;
+        const uint8_t* bg_map = &vram[(GET_BIT(r.lcdc, 3) ? 0x1C00 : 0x1800) + (bg_y / 8) * 32];
+
+        for (int x = x0 - ((x0 + r.scx) % 8); x < window_start; x += 8)
+        {
+            uint8_t bg_x = x + r.scx;
+            uint8_t id = bg_map[bg_x / 8];
+            uint16_t tile = (unsigned_tiles || id >= 128) ? id * 0x10 : 0x1000 + id * 0x10;
+
+            memcpy(&tiles[8 + x], memory.GetTileRow(tile + (bg_y % 8) * 2, false), 8);
+        }
+
+        if (window_active)
+        {
+            const uint8_t* window_map = &vram[(GET_BIT(r.lcdc, 6) ? 0x1C00 : 0x1800) + (job.window_line / 8) * 32];
+
+            for (int x = window_left + ((window_start - window_left) / 8) * 8; x < x1; x += 8)
+            {
+                uint8_t id = window_map[(x - window_left) / 8];
+                uint16_t tile = (unsigned_tiles || id >= 128) ? id * 0x10 : 0x1000 + id * 0x10;
+
+                memcpy(&tiles[8 + x], memory.GetTileRow(tile + (job.window_line % 8) * 2, false), 8);
+            }
+        }
+
+        memcpy(&ids[8 + x0], &tiles[8 + x0], x1 - x0);
+        kernels.map_palette(&ids[8 + x0], r.bgp, line + x0, x1 - x0);
+    }
+
+    uint8_t sprite_height = GET_BIT(job.segments[0].registers.lcdc, 2) ? 16 : 8;
+
+    // x positions already showing an opaque object pixel
+    bool covered[160] = { false };
+
+    // in the order the fifo fetches them, by x and then by oam index
+    for (uint8_t i = 0; i < job.object_count; i++)
+    {
+        const Sprite& sp = job.objects[i];
+
+        uint8_t row = ly + 16 - sp.y_pos;
+        if (GET_BIT(sp.flags, 6))
+        {
+            row = sprite_height - 1 - row;
+        }
+
+        uint16_t tile = (sp.tile + (row / 8)) * 0x10 + (row % 8) * 2;
+        const uint8_t* tile_row = memory.GetTileRow(tile, GET_BIT(sp.flags, 5));
+
+        // palettes as of the object's left edge
+        uint8_t s = job.segment_count - 1;
+        while (s > 0 && job.segments[s].x > sp.x_pos - 8)
+        {
+            s--;
+        }
+
+        const ScanlineRegisters& r = job.segments[s].registers;
+
+        uint8_t shades[8];
+        kernels.map_palette(tile_row, GET_BIT(sp.flags, 4) ? r.obp1 : r.obp0, shades, 8);
+
+        for (uint8_t p = 0; p < 8; p++)
+        {
+            int x = sp.x_pos + p - 8;
+            if (x < 0 || x >= 160)
+            {
+                continue;
+            }
+
+            if (tile_row[p] == 0 || covered[x])
+            {
+                continue;
+            }
+
+            covered[x] = true;
+
+            // behind background colors 1-3, still hides the objects after it
+            if (GET_BIT(sp.flags, 7) && ids[8 + x] != 0)
+            {
+                continue;
+            }
+
+            line[x] = shades[p];
+        }
+    }
+}
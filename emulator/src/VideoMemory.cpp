@@ -0,0 +1,88 @@
+#include "VideoMemory.h"
+
+#include <cstring>
+
+VideoMemory::VideoMemory()
+{
+    this->kernels = &GetPixelKernels();
+
+    this->Reset();
+}
+
+void VideoMemory::Reset()
+{
+    memset(this->vram, 0, sizeof(this->vram));
+
+    memset(this->tile_cache, 0, sizeof(this->tile_cache));
+    memset(this->tile_cache_flipped, 0, sizeof(this->tile_cache_flipped));
+    memset(this->tile_dirty_rows, 0, sizeof(this->tile_dirty_rows));
+}
+
+bool VideoMemory::Write(uint16_t offset, uint8_t data)
+{
+    if (this->vram[offset] == data)
+    {
+        return false;
+    }
+
+    if (offset < TILE_DATA_SIZE)
+    {
+        uint16_t row = offset / 2;
+        this->tile_dirty_rows[row / 64] |= (1ull << (row % 64));
+    }
+
+    this->vram[offset] = data;
+    return true;
+}
+
+const uint8_t* VideoMemory::GetTileRow(uint16_t offset, bool flipped)
+{
+    uint16_t row = offset / 2;
+    if (this->tile_dirty_rows[row / 64] & (1ull << (row % 64)))
+    {
+        this->DecodeTileRow(row);
+    }
+
+    return flipped ? this->tile_cache_flipped[row] : this->tile_cache[row];
+}
+
+void VideoMemory::DecodeTileRow(uint16_t row)
+{
+    this->kernels->decode_tile_row(this->vram[row * 2], this->vram[row * 2 + 1], this->tile_cache[row], this->tile_cache_flipped[row]);
+
+    this->tile_dirty_rows[row / 64] &= ~(1ull << (row % 64));
+}
+
+void VideoMemory::FlushTileCache()
+{
+    for (uint16_t word = 0; word < TILE_ROW_COUNT / 64; word++)
+    {
+        uint64_t dirty = this->tile_dirty_rows[word];
+        if (dirty == 0)
+        {
+            continue;
+        }
+
+        // decode runs of dirty rows together, tile uploads usually dirty whole blocks
+        uint16_t bit = 0;
+        while (bit < 64)
+        {
+            if ((dirty & (1ull << bit)) == 0)
+            {
+                bit++;
+                continue;
+            }
+
+            uint16_t start = bit;
+            while (bit < 64 && (dirty & (1ull << bit)))
+            {
+                bit++;
+            }
+
+            uint16_t row = word * 64 + start;
+            this->kernels->decode_tile_rows(&this->vram[row * 2], bit - start, this->tile_cache[row], this->tile_cache_flipped[row]);
+        }
+
+        this->tile_dirty_rows[word] = 0;
+    }
+}
@@ -0,0 +1,215 @@
+#include "PixelKernels.h"
+#include "BitwiseUtils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Checks every kernel set the host can run against GET_BIT and the scalar kernels,
+// returns non-zero when any of them differs
+
+#define LINE_WIDTH 160
+
+static int failures = 0;
+
+static void Fail(const char* set, const char* kernel, const char* detail, int value)
+{
+    // one line per mismatch is plenty, a broken kernel would print thousands
+    if (failures < 32)
+    {
+        std::printf("%s %s: %s %d\n", set, kernel, detail, value);
+    }
+
+    failures++;
+}
+
+static uint8_t GetColorID(uint8_t low, uint8_t high, int x)
+{
+    return (GET_BIT(high, 7 - x) << 1) | GET_BIT(low, 7 - x);
+}
+
+static void TestDecodeTileRow(const PixelKernels& kernels)
+{
+    for (int value = 0; value < 0x10000; value++)
+    {
+        uint8_t low = value & 0xFF;
+        uint8_t high = value >> 8;
+
+        uint8_t out[8];
+        uint8_t out_flipped[8];
+        kernels.decode_tile_row(low, high, out, out_flipped);
+
+        for (int x = 0; x < 8; x++)
+        {
+            uint8_t id = GetColorID(low, high, x);
+            if (out[x] != id || out_flipped[7 - x] != id)
+            {
+                Fail(kernels.name, "decode_tile_row", "low/high", value);
+                break;
+            }
+        }
+    }
+}
+
+static void TestDecodeTileRows(const PixelKernels& kernels)
+{
+    // every low/high pair once, as one run of rows so the wide steps see all of them
+    const uint32_t row_count = 0x10000;
+
+    std::vector<uint8_t> planar(row_count * 2);
+    for (uint32_t row = 0; row < row_count; row++)
+    {
+        planar[row * 2] = row & 0xFF;
+        planar[row * 2 + 1] = row >> 8;
+    }
+
+    std::vector<uint8_t> out(row_count * 8);
+    std::vector<uint8_t> out_flipped(row_count * 8);
+    kernels.decode_tile_rows(planar.data(), row_count, out.data(), out_flipped.data());
+
+    for (uint32_t row = 0; row < row_count; row++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            uint8_t id = GetColorID(planar[row * 2], planar[row * 2 + 1], x);
+            if (out[row * 8 + x] != id || out_flipped[row * 8 + 7 - x] != id)
+            {
+                Fail(kernels.name, "decode_tile_rows", "low/high", row);
+                break;
+            }
+        }
+    }
+
+    // short runs end in the scalar tail and must not write past their last row
+    for (uint32_t count = 0; count <= 16; count++)
+    {
+        uint8_t short_out[8 * 17];
+        uint8_t short_flipped[8 * 17];
+        memset(short_out, 0xEE, sizeof(short_out));
+        memset(short_flipped, 0xEE, sizeof(short_flipped));
+
+        kernels.decode_tile_rows(planar.data() + 0x1234 * 2, count, short_out, short_flipped);
+
+        if (memcmp(short_out, out.data() + 0x1234 * 8, count * 8) != 0 ||
+            memcmp(short_flipped, out_flipped.data() + 0x1234 * 8, count * 8) != 0)
+        {
+            Fail(kernels.name, "decode_tile_rows", "row count", count);
+        }
+
+        if (short_out[count * 8] != 0xEE || short_flipped[count * 8] != 0xEE)
+        {
+            Fail(kernels.name, "decode_tile_rows", "wrote past row count", count);
+        }
+    }
+}
+
+static void TestMapPalette(const PixelKernels& kernels, const PixelKernels& scalar)
+{
+    // a line holding every color id at every alignment
+    uint8_t ids[LINE_WIDTH];
+    for (int x = 0; x < LINE_WIDTH; x++)
+    {
+        ids[x] = (x + x / 4) & 3;
+    }
+
+    for (int palette = 0; palette < 256; palette++)
+    {
+        uint8_t expected[LINE_WIDTH];
+        uint8_t out[LINE_WIDTH + 1];
+        memset(out, 0xEE, sizeof(out));
+
+        scalar.map_palette(ids, (uint8_t)palette, expected, LINE_WIDTH);
+        kernels.map_palette(ids, (uint8_t)palette, out, LINE_WIDTH);
+
+        for (int x = 0; x < LINE_WIDTH; x++)
+        {
+            if (expected[x] != ((palette >> (ids[x] * 2)) & 3))
+            {
+                Fail(scalar.name, "map_palette", "palette", palette);
+                break;
+            }
+        }
+
+        if (memcmp(out, expected, LINE_WIDTH) != 0 || out[LINE_WIDTH] != 0xEE)
+        {
+            Fail(kernels.name, "map_palette", "palette", palette);
+        }
+    }
+}
+
+static void TestExpandShades(const PixelKernels& kernels, const PixelKernels& scalar)
+{
+    uint8_t shades[LINE_WIDTH];
+    for (int x = 0; x < LINE_WIDTH; x++)
+    {
+        shades[x] = (x * 7 + x / 3) & 3;
+    }
+
+    const uint8_t lut_8[4] = { 0xE0, 0x88, 0x34, 0x08 };
+    const uint16_t lut_16[4] = { 0xE7DA, 0x8E0E, 0x334A, 0x08C4 };
+    const uint32_t lut_32[4] = { 0xFFD0F8E0, 0xFF70C088, 0xFF566834, 0xFF201808 };
+
+    // every length up to a full line, for the tails after the wide steps
+    for (uint32_t count = 0; count <= LINE_WIDTH; count++)
+    {
+        uint8_t expected_8[LINE_WIDTH];
+        uint8_t out_8[LINE_WIDTH + 1];
+        memset(out_8, 0xEE, sizeof(out_8));
+        scalar.expand_shades_8(shades, lut_8, expected_8, count);
+        kernels.expand_shades_8(shades, lut_8, out_8, count);
+
+        if (memcmp(out_8, expected_8, count) != 0 || out_8[count] != 0xEE)
+        {
+            Fail(kernels.name, "expand_shades_8", "count", count);
+        }
+
+        uint16_t expected_16[LINE_WIDTH];
+        uint16_t out_16[LINE_WIDTH + 1];
+        memset(out_16, 0xEE, sizeof(out_16));
+        scalar.expand_shades_16(shades, lut_16, expected_16, count);
+        kernels.expand_shades_16(shades, lut_16, out_16, count);
+
+        if (memcmp(out_16, expected_16, count * sizeof(uint16_t)) != 0 || out_16[count] != 0xEEEE)
+        {
+            Fail(kernels.name, "expand_shades_16", "count", count);
+        }
+
+        uint32_t expected_32[LINE_WIDTH];
+        uint32_t out_32[LINE_WIDTH + 1];
+        memset(out_32, 0xEE, sizeof(out_32));
+        scalar.expand_shades_32(shades, lut_32, expected_32, count);
+        kernels.expand_shades_32(shades, lut_32, out_32, count);
+
+        if (memcmp(out_32, expected_32, count * sizeof(uint32_t)) != 0 || out_32[count] != 0xEEEEEEEE)
+        {
+            Fail(kernels.name, "expand_shades_32", "count", count);
+        }
+    }
+}
+
+int main()
+{
+    const PixelKernels* scalar = FindPixelKernels("scalar");
+
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    for (const char* name : names)
+    {
+        const PixelKernels* kernels = FindPixelKernels(name);
+        if (kernels == nullptr)
+        {
+            std::printf("%s: not supported by this cpu, skipped\n", name);
+            continue;
+        }
+
+        int previous_failures = failures;
+
+        TestDecodeTileRow(*kernels);
+        TestDecodeTileRows(*kernels);
+        TestMapPalette(*kernels, *scalar);
+        TestExpandShades(*kernels, *scalar);
+
+        std::printf("%s: %s\n", name, failures == previous_failures ? "ok" : "failed");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#include "RenderThread.h"
+#include "ScanlineRenderer.h"
+#include "VideoMemory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Queues lines and vram writes in random interleavings and checks each line the worker
+// draws against RenderScanline on a copy of vram updated in order, returns non-zero on a mismatch
+
+#define LINE_WIDTH 160
+#define TEST_LINE_COUNT 100000
+
+static ScanlineJob MakeJob(std::mt19937& random, uint8_t ly)
+{
+    ScanlineJob job = {};
+    job.ly = ly;
+    job.window_line = ly / 2;
+    job.window_reached = (random() & 1) != 0;
+
+    job.segment_count = 1 + random() % 3;
+    for (uint8_t i = 0; i < job.segment_count; i++)
+    {
+        ScanlineSegment& segment = job.segments[i];
+        segment.x = i == 0 ? 0 : (uint8_t)(job.segments[i - 1].x + 1 + random() % 40);
+
+        // bg, window and objects on, either tile data and map area
+        segment.registers.lcdc = 0x83 | (random() & 0x7C);
+        segment.registers.scy = random();
+        segment.registers.scx = random();
+        segment.registers.wy = random() % 144;
+        segment.registers.wx = random() % 167;
+        segment.registers.bgp = random();
+        segment.registers.obp0 = random();
+        segment.registers.obp1 = random();
+    }
+
+    job.object_count = random() % 11;
+    for (uint8_t i = 0; i < job.object_count; i++)
+    {
+        job.objects[i].y_pos = ly + 16 - random() % 8;
+        job.objects[i].x_pos = (uint8_t)(i * 16 + random() % 16);
+        job.objects[i].tile = random();
+        job.objects[i].flags = random() & 0xF0;
+    }
+
+    return job;
+}
+
+int main()
+{
+    std::mt19937 random(0x4C594C43);
+
+    VideoMemory memory;
+    for (uint16_t offset = 0; offset < 0x2000; offset++)
+    {
+        memory.Write(offset, random());
+    }
+
+    const PixelKernels& kernels = GetPixelKernels();
+    RenderThread* thread = new RenderThread(memory);
+
+    std::vector<uint8_t> expected((size_t)TEST_LINE_COUNT * LINE_WIDTH);
+    std::vector<uint8_t> lines((size_t)TEST_LINE_COUNT * LINE_WIDTH);
+
+    for (uint32_t i = 0; i < TEST_LINE_COUNT; i++)
+    {
+        // like the ppu, only writes that change a byte are forwarded. Runs longer than the
+        // write ring make the queue wait on the worker with no line queued.
+        uint32_t write_count = random() % 256 == 0 ? random() % (RENDER_THREAD_WRITE_COUNT * 2) : random() % 16;
+        for (uint32_t w = 0; w < write_count; w++)
+        {
+            uint16_t offset = random() % 0x2000;
+            uint8_t data = random();
+            if (memory.Write(offset, data))
+            {
+                thread->QueueVRAMWrite(offset, data);
+            }
+        }
+
+        ScanlineJob job = MakeJob(random, (uint8_t)(i % 144));
+        RenderScanline(memory, job, kernels, &expected[(size_t)i * LINE_WIDTH]);
+        thread->QueueLine(job, &lines[(size_t)i * LINE_WIDTH]);
+
+        // lets the worker catch up and go idle at different points
+        switch (random() % 64)
+        {
+        case 0:
+            std::this_thread::yield();
+            break;
+        case 1:
+            thread->WaitIdle();
+            break;
+        default:
+            break;
+        }
+    }
+
+    delete thread;
+
+    int mismatches = 0;
+    for (uint32_t i = 0; i < TEST_LINE_COUNT; i++)
+    {
+        if (memcmp(&lines[(size_t)i * LINE_WIDTH], &expected[(size_t)i * LINE_WIDTH], LINE_WIDTH) != 0)
+        {
+            if (mismatches < 32)
+            {
+                std::printf("line %u differs from the single threaded renderer\n", i);
+            }
+
+            mismatches++;
+        }
+    }
+
+    std::printf("%d of %d lines differ\n", mismatches, TEST_LINE_COUNT);
+    return mismatches == 0 ? 0 : 1;
+}